@@ -0,0 +1,401 @@
+#include "evdsptc.h"
+
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#define NS_AS_SEC (1000 * 1000 * 1000LL)
+
+#ifdef EVDSPTC_BROADCAST_WAKEUP
+#define WAKEUP_MODE "broadcast"
+#else
+#define WAKEUP_MODE "single"
+#endif
+
+static volatile long handled = 0;
+static long events_per_producer = 100000;
+
+typedef evdsptc_error_t (*create_t)(evdsptc_context_t* context,
+        evdsptc_event_callback_t queued_callback,
+        evdsptc_event_callback_t begin_callback,
+        evdsptc_event_callback_t end_callback);
+
+struct producer_arg {
+    evdsptc_context_t* context;
+    evdsptc_event_t* events;
+    long n;
+    pthread_barrier_t* barrier;
+};
+
+static long long timespec_diff(struct timespec *t1, struct timespec *t2){
+    return t2->tv_nsec - t1->tv_nsec + (t2->tv_sec - t1->tv_sec) * NS_AS_SEC;
+}
+
+static long long cpu_ns(void){
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * NS_AS_SEC +
+        (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000LL;
+}
+
+static long context_switches(void){
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+static bool handle_count(evdsptc_event_t* event){
+    (void)event;
+    __sync_fetch_and_add(&handled, 1);
+    return true;
+}
+
+static void* produce_routine(void* arg){
+    struct producer_arg* param = (struct producer_arg*)arg;
+    long i;
+
+    pthread_barrier_wait(param->barrier);
+    for(i = 0; i < param->n; i++) evdsptc_post(param->context, &param->events[i]);
+    return NULL;
+}
+
+static void bench_producers(const char* mode, create_t create, int producers){
+    evdsptc_context_t ctx;
+    evdsptc_event_t* events;
+    pthread_t th[EVDSPTC_MAX_THREADS];
+    struct producer_arg args[EVDSPTC_MAX_THREADS];
+    pthread_barrier_t barrier;
+    struct timespec begin, end;
+    long total = events_per_producer * producers;
+    long long ns;
+    long i;
+
+    events = (evdsptc_event_t*)malloc(sizeof(evdsptc_event_t) * total);
+    for(i = 0; i < total; i++) evdsptc_event_init(&events[i], handle_count, NULL, false, NULL);
+    handled = 0;
+
+    create(&ctx, NULL, NULL, NULL);
+    pthread_barrier_init(&barrier, NULL, producers + 1);
+    for(i = 0; i < producers; i++){
+        args[i].context = &ctx;
+        args[i].events = &events[i * events_per_producer];
+        args[i].n = events_per_producer;
+        args[i].barrier = &barrier;
+        pthread_create(&th[i], NULL, produce_routine, (void*)&args[i]);
+    }
+    pthread_barrier_wait(&barrier);
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for(i = 0; i < producers; i++) pthread_join(th[i], NULL);
+    while(handled < total) sched_yield();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    evdsptc_destroy(&ctx, true);
+    pthread_barrier_destroy(&barrier);
+    free(events);
+
+    ns = timespec_diff(&begin, &end);
+    printf("bench=producer_contention mode=%s producers=%d events=%ld ns=%lld ns_per_event=%.1f events_per_sec=%.0f\n",
+            mode, producers, total, ns, (double)ns / total, (double)total * NS_AS_SEC / ns);
+    fflush(stdout);
+}
+
+static void bench_mpsc(void){
+    int producers[] = {1, 2, 4, 8, 12};
+    int i;
+
+    for(i = 0; i < (int)(sizeof(producers) / sizeof(producers[0])); i++){
+        bench_producers("mutex", evdsptc_create, producers[i]);
+        bench_producers("lockfree", evdsptc_create_lockfree, producers[i]);
+    }
+}
+
+static int compare_ll(const void* a, const void* b){
+    long long x = *(const long long*)a;
+    long long y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_roundtrip_mode(const char* mode, create_t create){
+    evdsptc_context_t ctx;
+    evdsptc_event_t event;
+    struct timespec begin, end;
+    long roundtrips = events_per_producer / 10;
+    long long* ns;
+    long i;
+
+    if(roundtrips < 1) roundtrips = 1;
+    ns = (long long*)malloc(sizeof(long long) * roundtrips);
+    create(&ctx, NULL, NULL, NULL);
+    usleep(10 * 1000);
+
+    for(i = 0; i < roundtrips; i++){
+        evdsptc_event_init(&event, handle_count, NULL, false, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        evdsptc_post(&ctx, &event);
+        evdsptc_event_waitdone(&event);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ns[i] = timespec_diff(&begin, &end);
+    }
+    evdsptc_destroy(&ctx, true);
+
+    qsort(ns, roundtrips, sizeof(long long), compare_ll);
+    printf("bench=roundtrip mode=%s events=%ld min_ns=%lld p50_ns=%lld p99_ns=%lld p999_ns=%lld max_ns=%lld\n",
+            mode, roundtrips, ns[0], ns[roundtrips / 2], ns[roundtrips * 99 / 100], ns[roundtrips * 999 / 1000], ns[roundtrips - 1]);
+    fflush(stdout);
+    free(ns);
+}
+
+static void bench_roundtrip(void){
+    bench_roundtrip_mode("mutex", evdsptc_create);
+    bench_roundtrip_mode("lockfree", evdsptc_create_lockfree);
+}
+
+static void bench_pool_threads(int threads){
+    evdsptc_context_t ctx;
+    evdsptc_event_t* events;
+    struct timespec begin, end;
+    long total = events_per_producer;
+    long roundtrips = total / 10;
+    long csw;
+    long long ns;
+    long i;
+
+    events = (evdsptc_event_t*)malloc(sizeof(evdsptc_event_t) * total);
+    evdsptc_create_threadpool(&ctx, NULL, NULL, NULL, threads);
+    usleep(10 * 1000);
+
+    csw = context_switches();
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for(i = 0; i < roundtrips; i++){
+        evdsptc_event_init(&events[i], handle_count, NULL, false, NULL);
+        evdsptc_post(&ctx, &events[i]);
+        evdsptc_event_waitdone(&events[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    csw = context_switches() - csw;
+    ns = timespec_diff(&begin, &end);
+    printf("bench=pool_wakeup mode=roundtrip wakeup=%s threads=%d events=%ld ns=%lld ns_per_event=%.1f csw_per_event=%.2f\n",
+            WAKEUP_MODE, threads, roundtrips, ns, (double)ns / roundtrips, (double)csw / roundtrips);
+
+    for(i = 0; i < total; i++) evdsptc_event_init(&events[i], handle_count, NULL, false, NULL);
+    handled = 0;
+    csw = context_switches();
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for(i = 0; i < total; i++) evdsptc_post(&ctx, &events[i]);
+    while(handled < total) sched_yield();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    csw = context_switches() - csw;
+    ns = timespec_diff(&begin, &end);
+    printf("bench=pool_wakeup mode=throughput wakeup=%s threads=%d events=%ld ns=%lld events_per_sec=%.0f csw_per_event=%.2f\n",
+            WAKEUP_MODE, threads, total, ns, (double)total * NS_AS_SEC / ns, (double)csw / total);
+    fflush(stdout);
+
+    evdsptc_destroy(&ctx, true);
+    free(events);
+}
+
+static void bench_pool(void){
+    int threads[] = {1, 4, 16, 64};
+    int i;
+
+    for(i = 0; i < (int)(sizeof(threads) / sizeof(threads[0])); i++) bench_pool_threads(threads[i]);
+}
+
+static void bench_timer_depth(evdsptc_timerbackend_t backend, long pending){
+    evdsptc_context_t ctx;
+    evdsptc_event_t* events;
+    struct timespec resolution = {0, 1000 * 1000};
+    struct timespec timer;
+    struct timespec begin, end;
+    long long insert_ns, expire_cpu_ns;
+    long i;
+
+    events = (evdsptc_event_t*)malloc(sizeof(evdsptc_event_t) * pending);
+    evdsptc_create(&ctx, NULL, NULL, NULL);
+    evdsptc_settimerbackend(&ctx, backend, &resolution);
+    srand(1);
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for(i = 0; i < pending; i++){
+        timer.tv_sec = 10 + rand() % 50;
+        timer.tv_nsec = rand() % NS_AS_SEC;
+        evdsptc_event_init(&events[i], handle_count, NULL, false, NULL);
+        evdsptc_event_settimer(&events[i], &timer, EVDSPTC_TIMERTYPE_RELATIVE);
+        evdsptc_post(&ctx, &events[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    insert_ns = timespec_diff(&begin, &end);
+    evdsptc_destroy(&ctx, true);
+
+    evdsptc_create(&ctx, NULL, NULL, NULL);
+    evdsptc_settimerbackend(&ctx, backend, &resolution);
+    handled = 0;
+    for(i = 0; i < pending; i++){
+        timer.tv_sec = 0;
+        timer.tv_nsec = 200 * 1000 * 1000 + rand() % (100 * 1000 * 1000);
+        evdsptc_event_init(&events[i], handle_count, NULL, false, NULL);
+        evdsptc_event_settimer(&events[i], &timer, EVDSPTC_TIMERTYPE_RELATIVE);
+        evdsptc_post(&ctx, &events[i]);
+    }
+    expire_cpu_ns = cpu_ns();
+    for(i = 0; i < pending; i++) evdsptc_event_waitdone(&events[i]);
+    expire_cpu_ns = cpu_ns() - expire_cpu_ns;
+    evdsptc_destroy(&ctx, true);
+    free(events);
+
+    printf("bench=timer backend=%s pending=%ld insert_ns_per_timer=%.1f expire_cpu_ns_per_timer=%.1f\n",
+            backend == EVDSPTC_TIMERBACKEND_WHEEL ? "wheel" : "list", pending,
+            (double)insert_ns / pending, (double)expire_cpu_ns / pending);
+    fflush(stdout);
+}
+
+static void bench_timer(void){
+    long list_max = 10000;
+    long pending;
+    char* env = getenv("EVDSPTC_BENCH_TIMER_LIST_MAX");
+
+    if(env != NULL) list_max = atol(env);
+    for(pending = 10; pending <= 1000000; pending *= 10){
+        if(pending <= list_max) bench_timer_depth(EVDSPTC_TIMERBACKEND_LIST, pending);
+        bench_timer_depth(EVDSPTC_TIMERBACKEND_WHEEL, pending);
+    }
+}
+
+static bool handle_count_batch(evdsptc_event_t** events, int n){
+    (void)events;
+    __sync_fetch_and_add(&handled, n);
+    return true;
+}
+
+static void bench_batch_size(int batch_size, bool batch_handler){
+    evdsptc_context_t ctx;
+    evdsptc_event_t* events;
+    pthread_t th[4];
+    struct producer_arg args[4];
+    pthread_barrier_t barrier;
+    struct timespec begin, end;
+    int producers = 4;
+    long total = events_per_producer * producers;
+    long long ns, cpu;
+    long i;
+
+    events = (evdsptc_event_t*)malloc(sizeof(evdsptc_event_t) * total);
+    for(i = 0; i < total; i++){
+        evdsptc_event_init(&events[i], batch_handler ? NULL : handle_count, NULL, false, NULL);
+        if(batch_handler) evdsptc_event_setbatchhandler(&events[i], handle_count_batch);
+    }
+    handled = 0;
+
+    evdsptc_create(&ctx, NULL, NULL, NULL);
+    evdsptc_setbatchsize(&ctx, batch_size);
+    pthread_barrier_init(&barrier, NULL, producers + 1);
+    for(i = 0; i < producers; i++){
+        args[i].context = &ctx;
+        args[i].events = &events[i * events_per_producer];
+        args[i].n = events_per_producer;
+        args[i].barrier = &barrier;
+        pthread_create(&th[i], NULL, produce_routine, (void*)&args[i]);
+    }
+    pthread_barrier_wait(&barrier);
+    cpu = cpu_ns();
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for(i = 0; i < producers; i++) pthread_join(th[i], NULL);
+    while(handled < total) sched_yield();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    cpu = cpu_ns() - cpu;
+
+    evdsptc_destroy(&ctx, true);
+    pthread_barrier_destroy(&barrier);
+    free(events);
+
+    ns = timespec_diff(&begin, &end);
+    printf("bench=batch_dequeue handler=%s batch_size=%d producers=%d events=%ld ns_per_event=%.1f cpu_ns_per_event=%.1f events_per_sec=%.0f\n",
+            batch_handler ? "batch" : "single", batch_size, producers, total, (double)ns / total, (double)cpu / total, (double)total * NS_AS_SEC / ns);
+    fflush(stdout);
+}
+
+static void bench_batch(void){
+    int sizes[] = {1, 4, 16, 64};
+    int i;
+
+    for(i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++){
+        bench_batch_size(sizes[i], false);
+        bench_batch_size(sizes[i], true);
+    }
+}
+
+static long periodic_ticks = 1000;
+
+static bool handle_periodic_count(evdsptc_event_t* event){
+    return 0 == __sync_sub_and_fetch((long*)evdsptc_event_getparam(event), 1);
+}
+
+static bool handle_periodic_nop(evdsptc_event_t* event){
+    (void)event;
+    __sync_fetch_and_add(&handled, 1);
+    return false;
+}
+
+static void bench_periodic_threads(int threads, long interval_ns){
+    evdsptc_context_t ctx;
+    evdsptc_event_t counter;
+    evdsptc_event_t events[8];
+    evdsptc_periodstats_t stats;
+    struct timespec interval = {0, interval_ns};
+    long ticks = periodic_ticks;
+    int i;
+
+    evdsptc_create_periodic_threadpool(&ctx, NULL, NULL, NULL, &interval, threads);
+    for(i = 0; i < 8; i++){
+        evdsptc_event_init(&events[i], handle_periodic_nop, NULL, false, NULL);
+        evdsptc_post(&ctx, &events[i]);
+    }
+    evdsptc_event_init(&counter, handle_periodic_count, (void*)&ticks, false, NULL);
+    evdsptc_post(&ctx, &counter);
+    evdsptc_event_waitdone(&counter);
+    evdsptc_getperiodstats(&ctx, &stats, false);
+    evdsptc_destroy(&ctx, true);
+
+    printf("bench=periodic_jitter threads=%d interval_ns=%ld cycles=%llu overruns=%llu latency_min_ns=%lld latency_p50_ns=%lld latency_p99_ns=%lld latency_max_ns=%lld exec_p99_ns=%lld exec_max_ns=%lld\n",
+            threads, interval_ns, stats.cycles, stats.overruns,
+            stats.latency.min, evdsptc_histogram_percentile(&stats.latency, 50.0), evdsptc_histogram_percentile(&stats.latency, 99.0), stats.latency.max,
+            evdsptc_histogram_percentile(&stats.exec, 99.0), stats.exec.max);
+    fflush(stdout);
+}
+
+static void bench_periodic(void){
+    char* env = getenv("EVDSPTC_BENCH_TICKS");
+
+    if(env != NULL) periodic_ticks = atol(env);
+    bench_periodic_threads(1, 1000 * 1000);
+    bench_periodic_threads(4, 1000 * 1000);
+}
+
+struct bench_case {
+    const char* name;
+    void (*run)(void);
+};
+
+static const struct bench_case cases[] = {
+    {"roundtrip", bench_roundtrip},
+    {"mpsc", bench_mpsc},
+    {"pool", bench_pool},
+    {"timer", bench_timer},
+    {"batch", bench_batch},
+    {"periodic", bench_periodic},
+};
+
+int main(int ac, char** av){
+    int i, j;
+    bool selected;
+    char* env = getenv("EVDSPTC_BENCH_EVENTS");
+
+    if(env != NULL) events_per_producer = atol(env);
+
+    for(i = 0; i < (int)(sizeof(cases) / sizeof(cases[0])); i++){
+        selected = (ac < 2);
+        for(j = 1; j < ac; j++) if(0 == strcmp(av[j], cases[i].name)) selected = true;
+        if(selected) cases[i].run();
+    }
+    return 0;
+}
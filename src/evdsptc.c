@@ -1,7 +1,47 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include "evdsptc.h"
+#include <sched.h>
+#include <string.h>
+#include <limits.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <poll.h>
+#endif
+
+#define EVDSPTC_COMPLETION_PENDING (0)
+#define EVDSPTC_COMPLETION_WAITED (1)
+#define EVDSPTC_COMPLETION_DONE (2)
+
+#define EVDSPTC_EVENTPOOL_REFILL (32)
+#define EVDSPTC_STRAND_BUDGET (16)
+#define EVDSPTC_REACTOR_EVENTS (64)
+
+typedef struct {
+    evdsptc_event_t event;
+    evdsptc_eventpool_t* pool;
+} evdsptc_eventpool_elem_t;
 
 static pthread_mutexattr_t* evdsptc_pmutexattrinitializer = NULL;
 static pthread_mutexattr_t evdsptc_mutexattrinitializer;
+static __thread evdsptc_worker_t* evdsptc_current_worker = NULL;
+static __thread int evdsptc_current_shard = -1;
+static unsigned int evdsptc_shard_next = 0;
+
+static bool evdsptc_strand_run (evdsptc_event_t* event);
+static void evdsptc_strand_cancel (evdsptc_strand_t* strand, bool unschedule);
+static evdsptc_error_t evdsptc_keyed_push (evdsptc_context_t* context, evdsptc_worker_t* owner, evdsptc_event_t* event);
+static clockid_t evdsptc_timer_clock (evdsptc_context_t* context, evdsptc_event_t* event);
+static void evdsptc_event_uncount (evdsptc_context_t* context, evdsptc_event_t* event);
+
+static int evdsptc_slots_num (evdsptc_context_t* context){
+    return (context->threads_max > 0) ? context->threads_max : 1;
+}
 
 void evdsptc_list_init(evdsptc_list_t* list){
     list->root.root = NULL;
@@ -119,372 +159,2617 @@ int evdsptc_timespec_compare (struct timespec* l, struct timespec* r){
     return (int)(l->tv_nsec - r->tv_nsec);
 }
 
-static void* evdsptc_thread_routine(void* arg){
-    evdsptc_context_t* context = (evdsptc_context_t*)arg;
-    evdsptc_event_t* event;
-    bool finalize = false;
-    bool auto_destruct = false;
-    struct timespec now;
-    struct timespec next;
-    bool wakeup = false;
-    evdsptc_list_t periodic_events_handled;
-    int ret = 0;
-
-    while(1){
-        event = NULL;
-        pthread_mutex_lock(&context->mtx);
-        while(context->state == EVDSPTC_STATUS_RUNNING){
-            if(context->type == EVDSPTC_TYPE_PERIODIC){
-                if(!wakeup){
-                    evdsptc_list_init(&periodic_events_handled);
-                    clock_gettime(CLOCK_MONOTONIC, &now);
-                    next = evdsptc_timespec_add(&now, &context->interval);
-                    ret = EINTR;
-                    while(ret == EINTR) ret = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
-                    next = evdsptc_timespec_add(&next, &context->interval);
-                    context->period_count = 0; 
-                    wakeup = true;
-                    __sync_synchronize();
-                }
-                if(evdsptc_list_isempty(&context->list)){
-                    while(!evdsptc_list_isempty(&periodic_events_handled)) 
-                        evdsptc_list_push(&context->list, evdsptc_list_pop(&periodic_events_handled));
-                    ret = EINTR;
-                    clock_gettime(CLOCK_MONOTONIC, &now);
-                    pthread_mutex_unlock(&context->mtx);
-                    
-                    while(ret == EINTR) ret = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
-                    
-                    pthread_mutex_lock(&context->mtx);
-                    context->period_count++; 
-                    __sync_synchronize();
-                    if(evdsptc_timespec_compare(&next, &now) < 0) next = evdsptc_timespec_add(&now, &context->interval);
-                    else next = evdsptc_timespec_add(&next, &context->interval);
-                    event = NULL;
-                    break;
-                }else{
-                    event = (evdsptc_event_t*)evdsptc_list_pop(&context->list);
-                    break;
-                }
-            }else{
-                if(evdsptc_list_isempty(&context->list) && evdsptc_list_isempty(&context->timer_list)) 
-                    pthread_cond_wait(&context->cv, &context->mtx);
-                else if(!evdsptc_list_isempty(&context->timer_list)){
-                    event = (evdsptc_event_t*)evdsptc_listelem_next(evdsptc_list_iterator(&context->timer_list));
-                    clock_gettime(CLOCK_REALTIME, &now);
-                    if(evdsptc_timespec_compare(&event->timer, &now) <= 0){
-                        event = (evdsptc_event_t*)evdsptc_list_pop(&context->timer_list);
-                        break;
-                    }
-                    else if(!evdsptc_list_isempty(&context->list)){
-                        event = (evdsptc_event_t*)evdsptc_list_pop(&context->list);
-                        break;
-                    }
-                    else pthread_cond_timedwait(&context->cv, &context->mtx, &event->timer);
-                }
-                else{
-                    event = (evdsptc_event_t*)evdsptc_list_pop(&context->list);
-                    break;
-                }
-            }
-        }
-        if(context->state != EVDSPTC_STATUS_RUNNING) finalize = true;
-        pthread_mutex_unlock(&context->mtx);
-        
-        if(finalize == true){
-            EVDSPTC_TRACE("canceling event %p for finalizing ...", event); 
-            break;
-        }
-        else if(NULL == event) continue;
-        
-        EVDSPTC_TRACE("handling event %p ...", event); 
-
-        if(context->begin_callback != NULL) context->begin_callback(event);
-        if(event->handler != NULL) event->is_done = event->handler(event);
-        else event->is_done = true;
-        __sync_synchronize(); 
-        if(context->end_callback != NULL) context->end_callback(event);
-        auto_destruct = event->auto_destruct;
-        if(event->is_done == true) sem_post(&event->sem);
-        else if(context->type == EVDSPTC_TYPE_PERIODIC) evdsptc_list_push(&periodic_events_handled, (evdsptc_listelem_t*)event);
-        if(auto_destruct && event->destructor != NULL && event->is_done == true) 
-            event->destructor(event);
-    }
-    return NULL;
+// releases the waiters of the event. the futex is only woken if someone is waiting.
+static void evdsptc_event_complete(evdsptc_event_t* event){
+#ifdef __linux__
+    if(EVDSPTC_COMPLETION_WAITED == __atomic_exchange_n(&event->completion, EVDSPTC_COMPLETION_DONE, __ATOMIC_SEQ_CST))
+        syscall(SYS_futex, &event->completion, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+    sem_post(&event->sem);
+#endif
 }
 
-static evdsptc_error_t evdsptc_create_impl (evdsptc_context_t* context,
-        evdsptc_event_callback_t queued_callback,
-        evdsptc_event_callback_t begin_callback,
-        evdsptc_event_callback_t end_callback,
-        int threads_num,
-        evdsptc_type_t type
-        )
-{
-    evdsptc_error_t ret = EVDSPTC_ERROR_FAIL_CREATE_THREAD;
-    int i;
+static evdsptc_error_t evdsptc_event_wait(evdsptc_event_t* event, bool block){
+#ifdef __linux__
+    int state;
 
-    if(threads_num < 1 || EVDSPTC_MAX_THREADS < threads_num){
-        ret = EVDSPTC_ERROR_INVALID;
-        goto ERROR;
-    }else{
-        context->threads_num = threads_num;
+    while(EVDSPTC_COMPLETION_DONE != (state = __atomic_load_n(&event->completion, __ATOMIC_ACQUIRE))){
+        if(!block) return EVDSPTC_ERROR_NOT_DONE;
+        if(state == EVDSPTC_COMPLETION_PENDING && !__atomic_compare_exchange_n(&event->completion, &state,
+                    EVDSPTC_COMPLETION_WAITED, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) continue;
+        syscall(SYS_futex, &event->completion, FUTEX_WAIT_PRIVATE, EVDSPTC_COMPLETION_WAITED, NULL, NULL, 0);
     }
-   
-    if(0 != pthread_mutex_init(&context->mtx, evdsptc_pmutexattrinitializer)) return EVDSPTC_ERROR_FAIL_INIT_MUTEX;
-    if(0 != pthread_cond_init(&context->cv, NULL)) return EVDSPTC_ERROR_FAIL_INIT_COND;
-    
-    pthread_mutex_lock(&context->mtx);
+#else
+    errno = 0;
+    if(block) while(-1 == sem_wait(&event->sem) && errno == EINTR) continue;
+    else while(-1 == sem_trywait(&event->sem) && errno == EINTR) continue;
+    if(errno == EINVAL) return EVDSPTC_ERROR_INVALID;
+    if(errno == EAGAIN) return EVDSPTC_ERROR_NOT_DONE;
+    sem_post(&event->sem);
+#endif
+    return EVDSPTC_ERROR_NONE;
+}
 
-    evdsptc_list_init(&context->list);
-    evdsptc_list_init(&context->timer_list);
-    context->state = EVDSPTC_STATUS_RUNNING;
-    context->queued_callback = queued_callback;
-    context->begin_callback = begin_callback;
-    context->end_callback = end_callback; 
-    context->type = type;
+// clears the result of the previous post so that the event can be posted again.
+static void evdsptc_event_rearm(evdsptc_event_t* event){
+    event->is_done = false;
+    event->is_canceled = false;
+    event->due_ns = 0;
+#ifdef __linux__
+    __atomic_store_n(&event->completion, EVDSPTC_COMPLETION_PENDING, __ATOMIC_RELAXED);
+#else
+    while(0 == sem_trywait(&event->sem)) continue;
+#endif
+}
 
-    for(i = 0; i < context->threads_num; i++){
-        if(0 != pthread_create(&context->th[i], NULL, &evdsptc_thread_routine, (void*) context)){
-            ret = EVDSPTC_ERROR_FAIL_CREATE_THREAD;
-            goto ERROR;
-        }
-    }
+static long long int evdsptc_timespec_tons (struct timespec* t){
+    return t->tv_sec * 1000LL * 1000LL * 1000LL + t->tv_nsec;
+}
 
-    ret = EVDSPTC_ERROR_NONE;
-    goto DONE;
+// a relative deadline counts from the posting, so it is missed only by events queued in the EDF heap.
+static bool evdsptc_event_ismissed(evdsptc_context_t* context, evdsptc_event_t* event){
+    struct timespec now;
 
-ERROR:
-    context->state = EVDSPTC_STATUS_ERROR;
-DONE:
-    pthread_mutex_unlock(&context->mtx);
-    return ret;
+    if(context->sched_policy != EVDSPTC_SCHEDPOLICY_EDF || event->deadlinetype == EVDSPTC_TIMERTYPE_IMMEDIATE) return false;
+    if(event->deadlinetype == EVDSPTC_TIMERTYPE_RELATIVE && event->due_ns == 0) return false;
+    clock_gettime(CLOCK_REALTIME, &now);
+    if(event->deadlinetype == EVDSPTC_TIMERTYPE_ABSOLUTE) return evdsptc_timespec_compare(&event->deadline, &now) < 0;
+    return event->due_ns < evdsptc_timespec_tons(&now);
 }
 
-evdsptc_error_t evdsptc_create (evdsptc_context_t* context,
-        evdsptc_event_callback_t queued_callback,
-        evdsptc_event_callback_t begin_callback,
-        evdsptc_event_callback_t end_callback)
-{
-    return evdsptc_create_impl(context, queued_callback, begin_callback, end_callback, 1, EVDSPTC_TYPE_NORMAL);
-} 
-
-evdsptc_error_t evdsptc_create_threadpool (evdsptc_context_t* context,
-        evdsptc_event_callback_t queued_callback,
-        evdsptc_event_callback_t begin_callback,
-        evdsptc_event_callback_t end_callback,
-        int threads_num)
-{
-    return evdsptc_create_impl(context, queued_callback, begin_callback, end_callback, threads_num, EVDSPTC_TYPE_NORMAL);
-} 
+#ifdef __linux__
+static void evdsptc_eventfd_signal(int fd){
+    uint64_t value = 1;
+    while(-1 == write(fd, &value, sizeof(value)) && errno == EINTR) continue;
+}
 
-evdsptc_error_t evdsptc_create_periodic (evdsptc_context_t* context,
-        evdsptc_event_callback_t queued_callback,
-        evdsptc_event_callback_t begin_callback,
-        evdsptc_event_callback_t end_callback,
-        struct timespec* interval)
-{
-    context->interval = *interval;
-    return evdsptc_create_impl(context, queued_callback, begin_callback, end_callback, 1, EVDSPTC_TYPE_PERIODIC);
-} 
+static void evdsptc_eventfd_clear(int fd){
+    uint64_t value;
+    while(-1 == read(fd, &value, sizeof(value)) && errno == EINTR) continue;
+}
+#endif
+
+// queues the finished event to be reaped, makes the completion fd readable if it is not yet, and then completes it.
+// the event is linked before a waiter is released, and reaped only after it is completed.
+static void evdsptc_completion_push(evdsptc_context_t* context, evdsptc_event_t* event){
+    pthread_mutex_lock(&context->completion_mtx);
+    evdsptc_list_push(&context->completion_list, &event->listelem);
+#ifdef __linux__
+    if(!context->completion_signaled) evdsptc_eventfd_signal(context->completion_fd);
+#endif
+    context->completion_signaled = true;
+    evdsptc_event_complete(event);
+    pthread_mutex_unlock(&context->completion_mtx);
+}
 
-evdsptc_error_t evdsptc_cancel (evdsptc_context_t* context){
-    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
-    evdsptc_listelem_t* i;
-    evdsptc_event_t* e;
-    
-    pthread_mutex_lock(&context->mtx);
-    if(context->state == EVDSPTC_STATUS_RUNNING){
-        context->state = EVDSPTC_STATUS_DESTROYING;
-        pthread_cond_broadcast(&context->cv);
-    }
-    
-    i = evdsptc_list_iterator(&context->list);
+// the finished and canceled events of the user are handed back through the completion queue while it is enabled.
+static bool evdsptc_completion_isqueued(evdsptc_context_t* context, evdsptc_event_t* event){
+    return !event->auto_destruct && event->handler != evdsptc_strand_run && 0 <= __atomic_load_n(&context->completion_fd, __ATOMIC_ACQUIRE);
+}
 
-    while(evdsptc_listelem_hasnext(i)){
-        i = evdsptc_listelem_next(i);
-        e = (evdsptc_event_t*)i;
-        e->auto_destruct = false;
-        evdsptc_event_cancel(e);
+// cancels an event that is held by no queue of the context.
+static void evdsptc_event_drop(evdsptc_context_t* context, evdsptc_event_t* event){
+    if(!evdsptc_completion_isqueued(context, event)){
+        evdsptc_event_cancel(event);
+        return;
     }
-    pthread_mutex_unlock(&context->mtx);
-   
-    return ret;
+    EVDSPTC_TRACE("canceling event %p ...", event); 
+    event->is_canceled = true;
+    __sync_synchronize();
+    evdsptc_completion_push(context, event);
 }
 
-evdsptc_error_t evdsptc_destroy (evdsptc_context_t* context, bool join){
-    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
-    void* arg = NULL;
-    int i;
-
-    pthread_mutex_lock(&context->mtx);
-    if(context->state == EVDSPTC_STATUS_RUNNING){
-        context->state = EVDSPTC_STATUS_DESTROYING;
-        pthread_cond_broadcast(&context->cv);
+// cancels the events taken out of the queues, and gives back the capacity they reserved. context->mtx must not be locked.
+static void evdsptc_list_drop(evdsptc_context_t* context, evdsptc_list_t* list){
+    evdsptc_listelem_t* listelem;
+    while(NULL != (listelem = evdsptc_list_pop(list))){
+        evdsptc_event_uncount(context, (evdsptc_event_t*)listelem);
+        evdsptc_event_drop(context, (evdsptc_event_t*)listelem);
     }
-    pthread_mutex_unlock(&context->mtx);
+}
 
-    for(i = 0; i < context->threads_num; i++){
-        if(join) pthread_join(context->th[i], &arg);
-        else pthread_detach(context->th[i]);  
+static bool evdsptc_event_finish(evdsptc_context_t* context, evdsptc_event_t* event){
+    evdsptc_event_destructor_t destructor;
+    bool auto_destruct;
+    bool is_done;
+
+    __sync_synchronize(); 
+    if(evdsptc_event_ismissed(context, event)) __sync_fetch_and_add(&context->deadline_miss_count, 1);
+    if(context->end_callback != NULL) context->end_callback(event);
+    auto_destruct = event->auto_destruct;
+    destructor = event->destructor;
+    is_done = event->is_done;
+    // nothing touches the event after it is queued, since it may be reaped and freed at once.
+    if(is_done == true && evdsptc_completion_isqueued(context, event)){
+        evdsptc_completion_push(context, event);
+        return is_done;
     }
+    if(is_done == true) evdsptc_event_complete(event);
+    if(auto_destruct && is_done == true && destructor != NULL) 
+        destructor(event);
+    return is_done;
+}
 
-    evdsptc_list_destroy(&context->list);
-    evdsptc_list_destroy(&context->timer_list);
-   
-    return ret;
+static long long int evdsptc_timespec_diffns (struct timespec* from, struct timespec* to){
+    return (to->tv_sec - from->tv_sec) * 1000LL * 1000LL * 1000LL + (to->tv_nsec - from->tv_nsec);
 }
 
-void evdsptc_event_cancel (evdsptc_event_t* event){
-    event->is_canceled = true;
-    __sync_synchronize();
-    sem_post(&event->sem);
-    EVDSPTC_TRACE("canceling event %p ...", event); 
-    if(event->auto_destruct && event->destructor != NULL){
-        event->destructor(event);
-    }else{
-        event->auto_destruct = true;
-    }
+// histogram buckets are powers of two split into 1 << EVDSPTC_HISTOGRAM_SUBBITS linear sub-buckets.
+static int evdsptc_histogram_index (long long int value){
+    int msb;
+
+    if(value < (1LL << EVDSPTC_HISTOGRAM_SUBBITS)) return value < 0 ? 0 : (int)value;
+    msb = 63 - __builtin_clzll((unsigned long long int)value);
+    return ((msb - EVDSPTC_HISTOGRAM_SUBBITS + 1) << EVDSPTC_HISTOGRAM_SUBBITS)
+        | (int)((value >> (msb - EVDSPTC_HISTOGRAM_SUBBITS)) & ((1 << EVDSPTC_HISTOGRAM_SUBBITS) - 1));
 }
 
-static void evdsptc_listelem_cancel (evdsptc_listelem_t* listelem){
-    evdsptc_event_t* event = (evdsptc_event_t*)listelem;
-    evdsptc_event_cancel (event);
+// returns the largest value that falls into the bucket.
+static long long int evdsptc_histogram_bucketmax (int index){
+    int msb;
+    long long int lower;
+
+    if(index < (1 << EVDSPTC_HISTOGRAM_SUBBITS)) return index;
+    msb = (index >> EVDSPTC_HISTOGRAM_SUBBITS) + EVDSPTC_HISTOGRAM_SUBBITS - 1;
+    lower = (1LL << msb) | ((long long int)(index & ((1 << EVDSPTC_HISTOGRAM_SUBBITS) - 1)) << (msb - EVDSPTC_HISTOGRAM_SUBBITS));
+    return lower + (1LL << (msb - EVDSPTC_HISTOGRAM_SUBBITS)) - 1;
 }
 
-static bool evdsptc_event_isnearer (evdsptc_event_t* event, evdsptc_event_t* other){
-    return 0 > evdsptc_timespec_compare(&event->timer, &other->timer);
+static void evdsptc_histogram_record (evdsptc_histogram_t* histogram, long long int value){
+    if(value < 0) value = 0;
+    if(histogram->count == 0 || value < histogram->min) histogram->min = value;
+    if(histogram->count == 0 || histogram->max < value) histogram->max = value;
+    histogram->count++;
+    histogram->sum += value;
+    histogram->buckets[evdsptc_histogram_index(value)]++;
 }
 
-struct timespec evdsptc_timespec_add (struct timespec* a, struct timespec* b){
-    struct timespec ret;
-    ret = *a;
-    ret.tv_sec  += b->tv_sec;
-    ret.tv_nsec += b->tv_nsec;
-    long nsec_is_1sec = 1000L * 1000L * 1000L;
-    while(nsec_is_1sec <= ret.tv_nsec){
-        ret.tv_sec++;
-        ret.tv_nsec -= nsec_is_1sec;
-    }
-    return ret;
+// lock-free version of evdsptc_histogram_record. an empty histogram has min LLONG_MAX.
+static void evdsptc_histogram_add (evdsptc_histogram_t* histogram, long long int value){
+    long long int seen;
+
+    if(value < 0) value = 0;
+    __atomic_fetch_add(&histogram->buckets[evdsptc_histogram_index(value)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->sum, value, __ATOMIC_RELAXED);
+    seen = __atomic_load_n(&histogram->min, __ATOMIC_RELAXED);
+    while(value < seen && !__atomic_compare_exchange_n(&histogram->min, &seen, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    seen = __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+    while(seen < value && !__atomic_compare_exchange_n(&histogram->max, &seen, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
 }
 
-evdsptc_error_t evdsptc_post (evdsptc_context_t* context, evdsptc_event_t* event) 
-{
-    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
-    evdsptc_listelem_t* current = NULL;
-    evdsptc_listelem_t* next = NULL;
-    struct timespec now;
+// adds the histogram updated by evdsptc_histogram_add to merged, and clears it if reset is true.
+static void evdsptc_histogram_merge (evdsptc_histogram_t* merged, evdsptc_histogram_t* histogram, bool reset){
+    unsigned long long int n;
+    long long int min;
+    long long int max;
+    int i;
 
-    pthread_mutex_lock(&context->mtx);
-    if(context->state == EVDSPTC_STATUS_RUNNING){
-        pthread_cond_broadcast(&context->cv);
-        event->context = context;
-        if(EVDSPTC_TIMERTYPE_IMMEDIATE == event->timertype){
-            evdsptc_list_push(&context->list, &event->listelem);
-        }else{
-            if(EVDSPTC_TIMERTYPE_RELATIVE == event->timertype){
-                clock_gettime(CLOCK_REALTIME, &now);
-                event->timer = evdsptc_timespec_add(&now, &event->timer);
-            }
-            current = evdsptc_list_iterator(&context->timer_list);
-            while(evdsptc_listelem_hasnext(current)){
-                next = evdsptc_listelem_next(current);
-                if(evdsptc_event_isnearer(event, (evdsptc_event_t*)next)) break;
-                current = next;
-            }
-            evdsptc_listelem_insertnext(current, (evdsptc_listelem_t*)event);
-        }
-        if(context->queued_callback != NULL) context->queued_callback(event);
-    } else ret = EVDSPTC_ERROR_INVALID;
-    pthread_mutex_unlock(&context->mtx);
+    for(i = 0; i < EVDSPTC_HISTOGRAM_BUCKETS; i++){
+        if(reset) n = __atomic_exchange_n(&histogram->buckets[i], 0, __ATOMIC_RELAXED);
+        else n = __atomic_load_n(&histogram->buckets[i], __ATOMIC_RELAXED);
+        merged->buckets[i] += n;
+        merged->count += n;
+    }
+    if(reset){
+        merged->sum += __atomic_exchange_n(&histogram->sum, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&histogram->count, 0, __ATOMIC_RELAXED);
+        min = __atomic_exchange_n(&histogram->min, LLONG_MAX, __ATOMIC_RELAXED);
+        max = __atomic_exchange_n(&histogram->max, 0, __ATOMIC_RELAXED);
+    }else{
+        merged->sum += __atomic_load_n(&histogram->sum, __ATOMIC_RELAXED);
+        min = __atomic_load_n(&histogram->min, __ATOMIC_RELAXED);
+        max = __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+    }
+    if(min < merged->min) merged->min = min;
+    if(merged->max < max) merged->max = max;
+}
 
-    if(ret != EVDSPTC_ERROR_NONE) evdsptc_event_cancel(event);
+// returns the statistics of the calling worker, or NULL if the instrumentation is disabled.
+static evdsptc_eventstats_t* evdsptc_eventstats_current(evdsptc_context_t* context){
+    evdsptc_worker_t* worker = evdsptc_current_worker;
 
-    return ret;
+    if(!__atomic_load_n(&context->instrumented, __ATOMIC_RELAXED)) return NULL;
+    if(worker == NULL || worker->context != context) return &context->event_stats[0];
+    return &context->event_stats[worker->index];
 }
 
-evdsptc_error_t evdsptc_event_waitdone (evdsptc_event_t* event) 
-{
-    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
-    errno = 0;
-    while(-1 == sem_wait(&event->sem) && errno == EINTR) continue;
-    __sync_synchronize();
-    
-    if(errno == EINVAL) ret = EVDSPTC_ERROR_INVALID; 
-    else if(event->is_canceled == true) ret = EVDSPTC_ERROR_CANCELED;
+// records the time from the post, or from the timer for timer events, to now as the queue wait of the event.
+static void evdsptc_eventstats_begin(evdsptc_eventstats_t* stats, evdsptc_context_t* context, evdsptc_event_t* event, struct timespec* begin){
+    struct timespec now;
 
-    return ret;
+    clock_gettime(CLOCK_MONOTONIC, begin);
+    if(context->type == EVDSPTC_TYPE_PERIODIC) return;
+    if(EVDSPTC_TIMERTYPE_IMMEDIATE == event->timertype){
+        evdsptc_histogram_add(&stats->wait, evdsptc_timespec_diffns(&event->queued_time, begin));
+    }else{
+        clock_gettime(evdsptc_timer_clock(context, event), &now);
+        evdsptc_histogram_add(&stats->wait, evdsptc_timespec_diffns(&event->timer, &now));
+    }
 }
 
-evdsptc_error_t evdsptc_event_trywaitdone (evdsptc_event_t* event) 
-{
-    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
-    errno = 0;
-    while(-1 == sem_trywait(&event->sem) && errno == EINTR) continue;
-    __sync_synchronize();
-    
-    if(errno == EINVAL) ret = EVDSPTC_ERROR_INVALID; 
-    else if(errno == EAGAIN) ret = EVDSPTC_ERROR_NOT_DONE; 
-    else if(event->is_canceled == true) ret = EVDSPTC_ERROR_CANCELED;
+static void evdsptc_eventstats_end(evdsptc_eventstats_t* stats, struct timespec* begin, int n){
+    struct timespec now;
+    long long int service;
 
-    return ret;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    service = evdsptc_timespec_diffns(begin, &now) / n;
+    while(0 < n--) evdsptc_histogram_add(&stats->service, service);
 }
 
-evdsptc_error_t evdsptc_event_init (evdsptc_event_t* event, 
-        evdsptc_handler_t event_handler,
-        void* event_param,
-        bool auto_destruct,
-        evdsptc_event_destructor_t destructor)
-{
-    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
+// immediate events are counted against the capacity and the watermarks while they are queued.
+static bool evdsptc_queue_iscounted (evdsptc_context_t* context, evdsptc_event_t* event){
+    return __atomic_load_n(&context->bounded, __ATOMIC_RELAXED) &&
+        EVDSPTC_TIMERTYPE_IMMEDIATE == event->timertype && event->handler != evdsptc_strand_run;
+}
 
-    event->handler = event_handler;
-    event->param = event_param;
-    event->is_canceled = false;
-    event->is_done = false;
-    sem_init(&event->sem, 0, 0);
-    event->listelem.destructor = evdsptc_listelem_cancel;
-    event->destructor = destructor;
-    event->auto_destruct = auto_destruct;
-    event->timer.tv_sec = 0;
-    event->timer.tv_nsec = 0;
-    event->timertype = EVDSPTC_TIMERTYPE_IMMEDIATE;
+// counts n more queued events. returns the number of queued events, or -1 if it would exceed the capacity.
+static int evdsptc_queue_reserve (evdsptc_context_t* context, int n){
+    int capacity = __atomic_load_n(&context->capacity, __ATOMIC_RELAXED);
+    int queued = __atomic_add_fetch(&context->queued_num, n, __ATOMIC_SEQ_CST);
 
-    return ret;
+    if(0 < capacity && capacity < queued){
+        __atomic_sub_fetch(&context->queued_num, n, __ATOMIC_SEQ_CST);
+        return -1;
+    }
+    return queued;
 }
 
-void evdsptc_event_settimer (evdsptc_event_t* event, struct timespec* timer, evdsptc_timertype_t type)
-{
-    event->timer = *timer;
-    event->timertype = type;
+// calls the high watermark callback once the queue reaches the high watermark. context->mtx must not be locked.
+static void evdsptc_queue_notifyhigh (evdsptc_context_t* context, int queued){
+    if(context->high_watermark <= 0 || queued < context->high_watermark || __atomic_load_n(&context->congested, __ATOMIC_RELAXED)) return;
+    if(__sync_bool_compare_and_swap(&context->congested, false, true) && context->high_callback != NULL) context->high_callback(context);
 }
 
-void* evdsptc_event_getparam(evdsptc_event_t* event){
-    return event->param; 
-}
+// uncounts n dequeued events, calls the low watermark callback once the queue drains to the low watermark,
+// and wakes up the threads waiting for room. context->mtx must not be locked.
+static void evdsptc_queue_release (evdsptc_context_t* context, int n){
+    int queued = __atomic_sub_fetch(&context->queued_num, n, __ATOMIC_SEQ_CST);
 
-void evdsptc_event_free (evdsptc_event_t* event){
-    free(event);
+    if(queued <= context->low_watermark && __atomic_load_n(&context->congested, __ATOMIC_RELAXED)){
+        if(__sync_bool_compare_and_swap(&context->congested, true, false) && context->low_callback != NULL) context->low_callback(context);
+    }
+    if(0 < __atomic_load_n(&context->space_waiters, __ATOMIC_SEQ_CST)){
+        pthread_mutex_lock(&context->mtx);
+        pthread_cond_broadcast(&context->space_cv);
+        pthread_mutex_unlock(&context->mtx);
+    }
 }
 
-pthread_t* evdsptc_getthreads(evdsptc_context_t* context){
-    return context->th;
+static void evdsptc_event_uncount (evdsptc_context_t* context, evdsptc_event_t* event){
+    if(!event->counted) return;
+    event->counted = false;
+    evdsptc_queue_release(context, 1);
 }
 
-pthread_mutex_t* evdsptc_getmutex(evdsptc_context_t* context){
-    return &context->mtx;
-}
+static bool evdsptc_event_run(evdsptc_context_t* context, evdsptc_event_t* event){
+    evdsptc_eventstats_t* stats;
+    struct timespec begin;
 
-void evdsptc_setmutexattrinitializer(pthread_mutexattr_t* attr){
-    evdsptc_mutexattrinitializer = *attr;
-    evdsptc_pmutexattrinitializer = &evdsptc_mutexattrinitializer;
-}
+    // a strand runs its events with the callbacks by itself. nothing touches the strand event after it.
+    if(event->handler == evdsptc_strand_run) return evdsptc_strand_run(event);
 
-void evdsptc_event_makedone (evdsptc_event_t* event){
-    event->is_done = true;
-    __sync_synchronize();
-    sem_post(&event->sem);
+    evdsptc_event_uncount(context, event);
+    stats = evdsptc_eventstats_current(context);
+    EVDSPTC_TRACE("handling event %p ...", event); 
+
+    if(stats != NULL) evdsptc_eventstats_begin(stats, context, event, &begin);
+    if(context->begin_callback != NULL) context->begin_callback(event);
+    if(event->handler != NULL) event->is_done = event->handler(event);
+    else if(event->batch_handler != NULL) event->is_done = event->batch_handler(&event, 1);
+    else event->is_done = true;
+    if(stats != NULL) evdsptc_eventstats_end(stats, &begin, 1);
+    return evdsptc_event_finish(context, event);
+}
+
+// runs dequeued events in order. consecutive events sharing a batch handler are handled by a single call.
+static void evdsptc_events_run(evdsptc_context_t* context, evdsptc_event_t** events, int n){
+    evdsptc_eventstats_t* stats = evdsptc_eventstats_current(context);
+    struct timespec begin;
+    bool is_done;
+    int i;
+    int j;
+    int k;
+
+    for(i = 0; i < n; i++) evdsptc_event_uncount(context, events[i]);
+    if(context->drop_missed){
+        for(i = 0, j = 0; i < n; i++){
+            if(!evdsptc_event_ismissed(context, events[i])) events[j++] = events[i];
+            else{
+                EVDSPTC_TRACE("dropping event %p for its deadline ...", events[i]); 
+                __sync_fetch_and_add(&context->deadline_miss_count, 1);
+                evdsptc_event_drop(context, events[i]);
+            }
+        }
+        n = j;
+    }
+
+    for(i = 0; i < n; i = j){
+        for(j = i + 1; j < n && events[i]->handler == NULL && events[i]->batch_handler != NULL &&
+                events[j]->handler == NULL && events[j]->batch_handler == events[i]->batch_handler; j++);
+        if(j - i == 1){
+            evdsptc_event_run(context, events[i]);
+            continue;
+        }
+        EVDSPTC_TRACE("handling %d events from %p ...", j - i, events[i]); 
+        if(stats != NULL){
+            for(k = i; k < j; k++) evdsptc_eventstats_begin(stats, context, events[k], &begin);
+        }
+        if(context->begin_callback != NULL){
+            for(k = i; k < j; k++) context->begin_callback(events[k]);
+        }
+        is_done = events[i]->batch_handler(&events[i], j - i);
+        if(stats != NULL) evdsptc_eventstats_end(stats, &begin, j - i);
+        for(k = i; k < j; k++){
+            events[k]->is_done = is_done;
+            evdsptc_event_finish(context, events[k]);
+        }
+    }
+}
+
+static void evdsptc_mpsc_init(evdsptc_context_t* context){
+    context->mpsc_stub.root = NULL;
+    context->mpsc_stub.prev = NULL;
+    context->mpsc_stub.next = NULL;
+    context->mpsc_stub.destructor = NULL;
+    context->mpsc_head = &context->mpsc_stub;
+    context->mpsc_tail = &context->mpsc_stub;
+    context->mpsc_parked = 0;
+    context->mpsc_producers = 0;
+}
+
+// links an already chained run of elements from first to last with a single exchange.
+static void evdsptc_mpsc_pushchain(evdsptc_context_t* context, evdsptc_listelem_t* first, evdsptc_listelem_t* last){
+    evdsptc_listelem_t* prev;
+
+    __atomic_store_n(&last->next, NULL, __ATOMIC_RELAXED);
+    prev = __atomic_exchange_n(&context->mpsc_head, last, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&prev->next, first, __ATOMIC_RELEASE);
+}
+
+static void evdsptc_mpsc_push(evdsptc_context_t* context, evdsptc_listelem_t* listelem){
+    listelem->root = NULL;
+    listelem->prev = NULL;
+    evdsptc_mpsc_pushchain(context, listelem, listelem);
+}
+
+// consumer side only. NULL is returned when the queue is empty or a producer is still linking.
+static evdsptc_listelem_t* evdsptc_mpsc_pop(evdsptc_context_t* context){
+    evdsptc_listelem_t* tail = context->mpsc_tail;
+    evdsptc_listelem_t* next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+    if(tail == &context->mpsc_stub){
+        if(next == NULL) return NULL;
+        context->mpsc_tail = next;
+        tail = next;
+        next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    }
+    if(next == NULL){
+        if(tail != __atomic_load_n(&context->mpsc_head, __ATOMIC_SEQ_CST)) return NULL;
+        evdsptc_mpsc_push(context, &context->mpsc_stub);
+        next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+        if(next == NULL) return NULL;
+    }
+    context->mpsc_tail = next;
+    tail->next = NULL;
+    return tail;
+}
+
+static bool evdsptc_mpsc_isempty(evdsptc_context_t* context){
+    return context->mpsc_tail == &context->mpsc_stub &&
+        __atomic_load_n(&context->mpsc_head, __ATOMIC_SEQ_CST) == &context->mpsc_stub;
+}
+
+static void evdsptc_mpsc_wakeup(evdsptc_context_t* context){
+    if(__atomic_load_n(&context->mpsc_parked, __ATOMIC_SEQ_CST) == 0) return;
+    if(__atomic_exchange_n(&context->mpsc_parked, 0, __ATOMIC_SEQ_CST) == 0) return;
+    pthread_mutex_lock(&context->mtx);
+    pthread_cond_signal(&context->cv);
+    pthread_mutex_unlock(&context->mtx);
+}
+
+static bool evdsptc_event_isnearer (evdsptc_event_t* event, evdsptc_event_t* other){
+    return 0 > evdsptc_timespec_compare(&event->timer, &other->timer);
+}
+
+static unsigned long long int evdsptc_wheel_tick (evdsptc_timerwheel_t* wheel, struct timespec* timer, bool roundup){
+    long long int ns = evdsptc_timespec_diffns(&wheel->origin, timer);
+    if(ns <= 0) return 0;
+    if(roundup) ns += wheel->resolution_ns - 1;
+    return ns / wheel->resolution_ns;
+}
+
+static void evdsptc_wheel_insert (evdsptc_timerwheel_t* wheel, evdsptc_event_t* event){
+    unsigned long long int tick = evdsptc_wheel_tick(wheel, &event->timer, true);
+    int level;
+    int index;
+
+    if(tick < wheel->base){
+        evdsptc_list_push(&wheel->expired, &event->listelem);
+        return;
+    }
+    for(level = 0; level < EVDSPTC_WHEEL_LEVELS; level++){
+        if(tick - wheel->base < (1ULL << (EVDSPTC_WHEEL_BITS * (level + 1)))){
+            index = (tick >> (EVDSPTC_WHEEL_BITS * level)) & (EVDSPTC_WHEEL_SLOTS - 1);
+            evdsptc_list_push(&wheel->slots[level][index], &event->listelem);
+            wheel->bitmap[level] |= 1ULL << index;
+            return;
+        }
+    }
+    evdsptc_list_push(&wheel->overflow, &event->listelem);
+}
+
+static void evdsptc_wheel_reinsert (evdsptc_timerwheel_t* wheel, evdsptc_list_t* list){
+    evdsptc_list_t moved;
+    evdsptc_listelem_t* listelem;
+
+    evdsptc_list_init(&moved);
+    while(NULL != (listelem = evdsptc_list_pop(list))) evdsptc_list_push(&moved, listelem);
+    while(NULL != (listelem = evdsptc_list_pop(&moved))) evdsptc_wheel_insert(wheel, (evdsptc_event_t*)listelem);
+}
+
+static void evdsptc_wheel_cascade (evdsptc_timerwheel_t* wheel){
+    int level;
+    int index;
+
+    for(level = 1; level < EVDSPTC_WHEEL_LEVELS; level++){
+        index = (wheel->base >> (EVDSPTC_WHEEL_BITS * level)) & (EVDSPTC_WHEEL_SLOTS - 1);
+        wheel->bitmap[level] &= ~(1ULL << index);
+        evdsptc_wheel_reinsert(wheel, &wheel->slots[level][index]);
+        if(index != 0) return;
+    }
+    evdsptc_wheel_reinsert(wheel, &wheel->overflow);
+}
+
+// moves every event whose tick is not after target to the expired list.
+static void evdsptc_wheel_advance (evdsptc_timerwheel_t* wheel, unsigned long long int target){
+    unsigned long long int bits;
+    unsigned long long int next;
+    evdsptc_listelem_t* listelem;
+    int index;
+
+    while(wheel->base <= target){
+        index = wheel->base & (EVDSPTC_WHEEL_SLOTS - 1);
+        if(index == 0) evdsptc_wheel_cascade(wheel);
+        bits = wheel->bitmap[0] >> index;
+        if(bits == 0){
+            next = (wheel->base | (EVDSPTC_WHEEL_SLOTS - 1)) + 1;
+            wheel->base = next <= target ? next : target + 1;
+            continue;
+        }
+        wheel->base += __builtin_ctzll(bits);
+        if(wheel->base > target){
+            wheel->base = target + 1;
+            break;
+        }
+        index = wheel->base & (EVDSPTC_WHEEL_SLOTS - 1);
+        wheel->bitmap[0] &= ~(1ULL << index);
+        while(NULL != (listelem = evdsptc_list_pop(&wheel->slots[0][index]))) evdsptc_list_push(&wheel->expired, listelem);
+        wheel->base++;
+    }
+}
+
+// returns the earliest tick at which an event may expire or a cascade is needed.
+static bool evdsptc_wheel_nexttick (evdsptc_timerwheel_t* wheel, unsigned long long int* tick){
+    unsigned long long int best = ~0ULL;
+    unsigned long long int bits;
+    unsigned long long int candidate;
+    int level;
+    int shift;
+
+    if(!evdsptc_list_isempty(&wheel->expired)){
+        *tick = 0;
+        return true;
+    }
+    bits = wheel->bitmap[0] >> (wheel->base & (EVDSPTC_WHEEL_SLOTS - 1));
+    if(bits != 0) best = wheel->base + __builtin_ctzll(bits);
+    else if(wheel->bitmap[0] != 0) best = (wheel->base | (EVDSPTC_WHEEL_SLOTS - 1)) + 1 + __builtin_ctzll(wheel->bitmap[0]);
+    for(level = 1; level < EVDSPTC_WHEEL_LEVELS; level++){
+        if(wheel->bitmap[level] == 0) continue;
+        shift = ((wheel->base >> (EVDSPTC_WHEEL_BITS * level)) + 1) & (EVDSPTC_WHEEL_SLOTS - 1);
+        bits = shift == 0 ? wheel->bitmap[level] : (wheel->bitmap[level] >> shift) | (wheel->bitmap[level] << (EVDSPTC_WHEEL_SLOTS - shift));
+        candidate = ((wheel->base >> (EVDSPTC_WHEEL_BITS * level)) + 1 + __builtin_ctzll(bits)) << (EVDSPTC_WHEEL_BITS * level);
+        if(candidate < best) best = candidate;
+    }
+    if(!evdsptc_list_isempty(&wheel->overflow)){
+        candidate = ((wheel->base >> (EVDSPTC_WHEEL_BITS * EVDSPTC_WHEEL_LEVELS)) + 1) << (EVDSPTC_WHEEL_BITS * EVDSPTC_WHEEL_LEVELS);
+        if(candidate < best) best = candidate;
+    }
+    *tick = best;
+    return best != ~0ULL;
+}
+
+static void evdsptc_wheel_destroy (evdsptc_timerwheel_t* wheel){
+    int level;
+    int index;
+
+    for(level = 0; level < EVDSPTC_WHEEL_LEVELS; level++){
+        for(index = 0; index < EVDSPTC_WHEEL_SLOTS; index++) evdsptc_list_destroy(&wheel->slots[level][index]);
+    }
+    evdsptc_list_destroy(&wheel->overflow);
+    evdsptc_list_destroy(&wheel->expired);
+}
+
+// relative timers of the timerfd backend are kept on CLOCK_MONOTONIC, so that steps of the wall clock do not move them.
+static clockid_t evdsptc_timer_clock (evdsptc_context_t* context, evdsptc_event_t* event){
+    if(context->timer_backend == EVDSPTC_TIMERBACKEND_TIMERFD && EVDSPTC_TIMERTYPE_RELATIVE == event->timertype) return CLOCK_MONOTONIC;
+    return CLOCK_REALTIME;
+}
+
+// moves the timer of the event from the clock read as from to the clock read as to, keeping the time left.
+static void evdsptc_timer_rebase (evdsptc_event_t* event, struct timespec* from, struct timespec* to){
+    long long int left = evdsptc_timespec_diffns(from, &event->timer);
+    struct timespec offset;
+
+    if(left < 0) left = 0;
+    offset.tv_sec = (time_t)(left / (1000LL * 1000LL * 1000LL));
+    offset.tv_nsec = (long)(left % (1000LL * 1000LL * 1000LL));
+    event->timer = evdsptc_timespec_add(to, &offset);
+}
+
+// makes the timer thread re-arm its timerfds. context->mtx must be locked.
+static void evdsptc_timer_kick (evdsptc_context_t* context){
+#ifdef __linux__
+    if(0 <= context->timer_kickfd) evdsptc_eventfd_signal(context->timer_kickfd);
+#else
+    (void)context;
+#endif
+}
+
+static evdsptc_list_t* evdsptc_timer_list (evdsptc_context_t* context, evdsptc_event_t* event){
+    return evdsptc_timer_clock(context, event) == CLOCK_MONOTONIC ? &context->timer_monolist : &context->timer_list;
+}
+
+// inserts the event into the sorted list. returns true if it became the first one.
+static bool evdsptc_timer_listinsert (evdsptc_list_t* list, evdsptc_event_t* event){
+    evdsptc_listelem_t* current = evdsptc_list_iterator(list);
+    evdsptc_listelem_t* next = NULL;
+
+    while(evdsptc_listelem_hasnext(current)){
+        next = evdsptc_listelem_next(current);
+        if(evdsptc_event_isnearer(event, (evdsptc_event_t*)next)) break;
+        current = next;
+    }
+    evdsptc_listelem_insertnext(current, (evdsptc_listelem_t*)event);
+    return current == evdsptc_list_iterator(list);
+}
+
+static void evdsptc_timer_insert (evdsptc_context_t* context, evdsptc_event_t* event){
+    if(context->timer_backend == EVDSPTC_TIMERBACKEND_WHEEL){
+        evdsptc_wheel_insert(context->timer_wheel, event);
+    }else if(context->timer_backend == EVDSPTC_TIMERBACKEND_TIMERFD){
+        if(evdsptc_timer_listinsert(evdsptc_timer_list(context, event), event)) evdsptc_timer_kick(context);
+    }else{
+        evdsptc_timer_listinsert(&context->timer_list, event);
+    }
+    context->timer_num++;
+}
+
+// stable merge sort of timer events by their timer.
+static void evdsptc_timer_sortlist (evdsptc_list_t* list, int n){
+    evdsptc_list_t second;
+    evdsptc_list_t first;
+    evdsptc_listelem_t* l;
+    evdsptc_listelem_t* r;
+    int i;
+
+    if(n < 2) return;
+    evdsptc_list_init(&first);
+    evdsptc_list_init(&second);
+    for(i = 0; i < n / 2; i++) evdsptc_list_push(&first, evdsptc_list_pop(list));
+    while(NULL != (l = evdsptc_list_pop(list))) evdsptc_list_push(&second, l);
+    evdsptc_timer_sortlist(&first, n / 2);
+    evdsptc_timer_sortlist(&second, n - n / 2);
+
+    while(!evdsptc_list_isempty(&first) && !evdsptc_list_isempty(&second)){
+        l = evdsptc_listelem_next(evdsptc_list_iterator(&first));
+        r = evdsptc_listelem_next(evdsptc_list_iterator(&second));
+        if(evdsptc_event_isnearer((evdsptc_event_t*)r, (evdsptc_event_t*)l)) evdsptc_list_push(list, evdsptc_list_pop(&second));
+        else evdsptc_list_push(list, evdsptc_list_pop(&first));
+    }
+    while(NULL != (l = evdsptc_list_pop(&first))) evdsptc_list_push(list, l);
+    while(NULL != (r = evdsptc_list_pop(&second))) evdsptc_list_push(list, r);
+}
+
+// sorts n timer events and merges them into the sorted list in one pass. returns true if the first one changed.
+static bool evdsptc_timer_mergelist (evdsptc_list_t* sorted, evdsptc_list_t* list, int n){
+    evdsptc_listelem_t* first = evdsptc_listelem_next(evdsptc_list_iterator(sorted));
+    evdsptc_listelem_t* current;
+    evdsptc_listelem_t* listelem;
+
+    evdsptc_timer_sortlist(list, n);
+    current = evdsptc_list_iterator(sorted);
+    while(NULL != (listelem = evdsptc_list_pop(list))){
+        while(evdsptc_listelem_hasnext(current) &&
+                !evdsptc_event_isnearer((evdsptc_event_t*)listelem, (evdsptc_event_t*)evdsptc_listelem_next(current)))
+            current = evdsptc_listelem_next(current);
+        current = evdsptc_listelem_insertnext(current, listelem);
+    }
+    return first != evdsptc_listelem_next(evdsptc_list_iterator(sorted));
+}
+
+// inserts n timer events, sorting them and merging them into the timer list in one pass.
+static void evdsptc_timer_insertlist (evdsptc_context_t* context, evdsptc_list_t* list, int n){
+    evdsptc_list_t monotonic;
+    evdsptc_list_t realtime;
+    evdsptc_listelem_t* listelem;
+    bool kick;
+    int monotonic_num = 0;
+
+    if(context->timer_backend == EVDSPTC_TIMERBACKEND_WHEEL){
+        while(NULL != (listelem = evdsptc_list_pop(list))) evdsptc_wheel_insert(context->timer_wheel, (evdsptc_event_t*)listelem);
+    }else if(context->timer_backend == EVDSPTC_TIMERBACKEND_TIMERFD){
+        evdsptc_list_init(&monotonic);
+        evdsptc_list_init(&realtime);
+        while(NULL != (listelem = evdsptc_list_pop(list))){
+            if(evdsptc_timer_clock(context, (evdsptc_event_t*)listelem) == CLOCK_MONOTONIC){
+                evdsptc_list_push(&monotonic, listelem);
+                monotonic_num++;
+            }else evdsptc_list_push(&realtime, listelem);
+        }
+        kick = evdsptc_timer_mergelist(&context->timer_monolist, &monotonic, monotonic_num);
+        if(evdsptc_timer_mergelist(&context->timer_list, &realtime, n - monotonic_num) || kick) evdsptc_timer_kick(context);
+    }else{
+        evdsptc_timer_mergelist(&context->timer_list, list, n);
+    }
+    context->timer_num += n;
+}
+
+// unlinks a pending timer event in O(1). returns false if the event is not held by the timer backend.
+static bool evdsptc_timer_remove (evdsptc_context_t* context, evdsptc_event_t* event){
+    evdsptc_timerwheel_t* wheel = context->timer_wheel;
+    evdsptc_listelem_t* root = event->listelem.root;
+    evdsptc_list_t* slot = NULL;
+    int offset;
+
+    if(root == NULL) return false;
+    if(context->timer_backend == EVDSPTC_TIMERBACKEND_WHEEL){
+        if(root >= &wheel->slots[0][0].root && root <= &wheel->slots[EVDSPTC_WHEEL_LEVELS - 1][EVDSPTC_WHEEL_SLOTS - 1].root)
+            slot = (evdsptc_list_t*)root;
+        else if(root != &wheel->overflow.root && root != &wheel->expired.root) return false;
+    }else if(root != &context->timer_list.root && root != &context->timer_monolist.root) return false;
+
+    evdsptc_listelem_remove(&event->listelem);
+    if(slot != NULL && evdsptc_list_isempty(slot)){
+        offset = (int)(slot - &wheel->slots[0][0]);
+        wheel->bitmap[offset / EVDSPTC_WHEEL_SLOTS] &= ~(1ULL << (offset % EVDSPTC_WHEEL_SLOTS));
+    }
+    context->timer_num--;
+    return true;
+}
+
+static bool evdsptc_timer_isempty (evdsptc_context_t* context){
+    return context->timer_num == 0;
+}
+
+// tells if the first timer event of the sorted list has expired on the clock.
+static bool evdsptc_timer_isfirstexpired (evdsptc_list_t* list, clockid_t clock){
+    evdsptc_event_t* event = (evdsptc_event_t*)evdsptc_listelem_next(evdsptc_list_iterator(list));
+    struct timespec now;
+
+    if(event == NULL) return false;
+    clock_gettime(clock, &now);
+    return evdsptc_timespec_compare(&event->timer, &now) <= 0;
+}
+
+// pops the first timer event of the sorted list if it has expired on the clock.
+static evdsptc_event_t* evdsptc_timer_popfirst (evdsptc_list_t* list, clockid_t clock){
+    if(!evdsptc_timer_isfirstexpired(list, clock)) return NULL;
+    return (evdsptc_event_t*)evdsptc_list_pop(list);
+}
+
+// tells if a timer event of the timerfd backend has expired. context->mtx must be locked.
+// the wakeup of the timer thread may come before a worker parks, so the worker checks this under the lock.
+static bool evdsptc_timer_hasexpired (evdsptc_context_t* context){
+    if(evdsptc_timer_isempty(context) || context->timer_backend != EVDSPTC_TIMERBACKEND_TIMERFD) return false;
+    return evdsptc_timer_isfirstexpired(&context->timer_monolist, CLOCK_MONOTONIC) || evdsptc_timer_isfirstexpired(&context->timer_list, CLOCK_REALTIME);
+}
+
+static evdsptc_event_t* evdsptc_timer_popexpired (evdsptc_context_t* context){
+    evdsptc_timerwheel_t* wheel = context->timer_wheel;
+    evdsptc_event_t* event;
+    struct timespec now;
+    unsigned long long int tick;
+
+    if(evdsptc_timer_isempty(context)) return NULL;
+    if(context->timer_backend == EVDSPTC_TIMERBACKEND_WHEEL){
+        if(evdsptc_list_isempty(&wheel->expired)){
+            clock_gettime(CLOCK_REALTIME, &now);
+            tick = evdsptc_wheel_tick(wheel, &now, false);
+            if(tick < wheel->base) return NULL;
+            evdsptc_wheel_advance(wheel, tick);
+        }
+        event = (evdsptc_event_t*)evdsptc_list_pop(&wheel->expired);
+    }else if(context->timer_backend == EVDSPTC_TIMERBACKEND_TIMERFD){
+        if(NULL == (event = evdsptc_timer_popfirst(&context->timer_monolist, CLOCK_MONOTONIC)))
+            event = evdsptc_timer_popfirst(&context->timer_list, CLOCK_REALTIME);
+    }else{
+        event = evdsptc_timer_popfirst(&context->timer_list, CLOCK_REALTIME);
+    }
+    if(event != NULL) context->timer_num--;
+    return event;
+}
+
+// returns the time to wake up for the nearest timer event, or NULL if there is no timer event.
+// with the timerfd backend, it is always NULL since the timer thread wakes up the workers.
+static struct timespec* evdsptc_timer_nearest (evdsptc_context_t* context){
+    evdsptc_timerwheel_t* wheel = context->timer_wheel;
+    unsigned long long int tick;
+    struct timespec offset;
+
+    if(evdsptc_timer_isempty(context) || context->timer_backend == EVDSPTC_TIMERBACKEND_TIMERFD) return NULL;
+    if(context->timer_backend == EVDSPTC_TIMERBACKEND_WHEEL){
+        if(!evdsptc_wheel_nexttick(wheel, &tick)) return NULL;
+        offset.tv_sec = (time_t)((tick * wheel->resolution_ns) / (1000ULL * 1000ULL * 1000ULL));
+        offset.tv_nsec = (long)((tick * wheel->resolution_ns) % (1000ULL * 1000ULL * 1000ULL));
+        wheel->nearest = evdsptc_timespec_add(&wheel->origin, &offset);
+        return &wheel->nearest;
+    }
+    return &((evdsptc_event_t*)evdsptc_listelem_next(evdsptc_list_iterator(&context->timer_list)))->timer;
+}
+
+// moves every pending timer event out of the timer backend. context->mtx must be locked.
+static void evdsptc_timer_takeall (evdsptc_context_t* context, evdsptc_list_t* pending){
+    evdsptc_timerwheel_t* wheel = context->timer_wheel;
+    evdsptc_listelem_t* listelem;
+    int level;
+    int index;
+
+    while(NULL != (listelem = evdsptc_list_pop(&context->timer_list))) evdsptc_list_push(pending, listelem);
+    while(NULL != (listelem = evdsptc_list_pop(&context->timer_monolist))) evdsptc_list_push(pending, listelem);
+    if(wheel != NULL){
+        while(NULL != (listelem = evdsptc_list_pop(&wheel->expired))) evdsptc_list_push(pending, listelem);
+        for(level = 0; level < EVDSPTC_WHEEL_LEVELS; level++){
+            for(index = 0; index < EVDSPTC_WHEEL_SLOTS; index++){
+                while(NULL != (listelem = evdsptc_list_pop(&wheel->slots[level][index]))) evdsptc_list_push(pending, listelem);
+            }
+            wheel->bitmap[level] = 0;
+        }
+        while(NULL != (listelem = evdsptc_list_pop(&wheel->overflow))) evdsptc_list_push(pending, listelem);
+    }
+    context->timer_num = 0;
+}
+
+static void evdsptc_timer_destroy (evdsptc_context_t* context){
+    evdsptc_list_destroy(&context->timer_list);
+    evdsptc_list_destroy(&context->timer_monolist);
+    if(context->timer_wheel != NULL){
+        evdsptc_wheel_destroy(context->timer_wheel);
+        free(context->timer_wheel);
+        context->timer_wheel = NULL;
+    }
+    context->timer_backend = EVDSPTC_TIMERBACKEND_LIST;
+    context->timer_num = 0;
+}
+
+// an event without deadline has a zero due time in the heap, unless it is aged.
+static bool evdsptc_edf_hasdeadline(evdsptc_event_t* event){
+    return event->deadlinetype != EVDSPTC_TIMERTYPE_IMMEDIATE || event->due_ns != 0;
+}
+
+// the sequence wraps around, but the events in the heap are never that far apart.
+static bool evdsptc_edf_isearlier(evdsptc_event_t* event, evdsptc_event_t* other){
+    bool has_deadline = evdsptc_edf_hasdeadline(event);
+
+    if(has_deadline != evdsptc_edf_hasdeadline(other)) return has_deadline;
+    if(has_deadline && event->due_ns != other->due_ns) return event->due_ns < other->due_ns;
+    return (int)(event->sequence - other->sequence) < 0;
+}
+
+// makes room for n more events in the deadline heap. context->mtx must be locked.
+static bool evdsptc_edf_reserve(evdsptc_context_t* context, int n){
+    evdsptc_event_t** heap;
+    int capacity = context->edf_capacity;
+
+    if(context->sched_policy != EVDSPTC_SCHEDPOLICY_EDF || context->edf_num + n <= capacity) return true;
+    if(capacity < 64) capacity = 64;
+    while(capacity < context->edf_num + n) capacity *= 2;
+    heap = (evdsptc_event_t**)realloc(context->edf_heap, sizeof(evdsptc_event_t*) * capacity);
+    if(heap == NULL) return false;
+    context->edf_heap = heap;
+    context->edf_capacity = capacity;
+    return true;
+}
+
+static void evdsptc_edf_push(evdsptc_context_t* context, evdsptc_event_t* event){
+    evdsptc_event_t** heap = context->edf_heap;
+    int i = context->edf_num++;
+
+    event->sequence = (unsigned int)context->edf_sequence++;
+    while(i > 0 && evdsptc_edf_isearlier(event, heap[(i - 1) / 2])){
+        heap[i] = heap[(i - 1) / 2];
+        heap[i]->heap_index = i;
+        i = (i - 1) / 2;
+    }
+    heap[i] = event;
+    event->heap_index = i;
+}
+
+static evdsptc_event_t* evdsptc_edf_pop(evdsptc_context_t* context){
+    evdsptc_event_t** heap = context->edf_heap;
+    evdsptc_event_t* top;
+    evdsptc_event_t* last;
+    int i = 0;
+    int child;
+
+    if(context->edf_num == 0) return NULL;
+    top = heap[0];
+    last = heap[--context->edf_num];
+    while((child = i * 2 + 1) < context->edf_num){
+        if(child + 1 < context->edf_num && evdsptc_edf_isearlier(heap[child + 1], heap[child])) child++;
+        if(!evdsptc_edf_isearlier(heap[child], last)) break;
+        heap[i] = heap[child];
+        heap[i]->heap_index = i;
+        i = child;
+    }
+    heap[i] = last;
+    last->heap_index = i;
+    return top;
+}
+
+// priority 0 is context->list, the others have their own list. context->mtx must be locked for the helpers below.
+static evdsptc_list_t* evdsptc_ready_list(evdsptc_context_t* context, int priority){
+    if(priority == 0) return &context->list;
+    return &context->priority_list[priority - 1];
+}
+
+static bool evdsptc_ready_isempty(evdsptc_context_t* context){
+    if(context->sched_policy == EVDSPTC_SCHEDPOLICY_EDF) return context->edf_num == 0;
+    return context->priority_bitmap == 0;
+}
+
+// with EDF, evdsptc_edf_reserve must have succeeded beforehand.
+static void evdsptc_ready_push(evdsptc_context_t* context, evdsptc_event_t* event){
+    struct timespec now;
+
+    if(context->sched_policy == EVDSPTC_SCHEDPOLICY_EDF){
+        // the due time is kept once computed, so that the events moved between the policies keep their place.
+        if(EVDSPTC_TIMERTYPE_ABSOLUTE == event->deadlinetype){
+            event->due_ns = evdsptc_timespec_tons(&event->deadline);
+        }else if(EVDSPTC_TIMERTYPE_RELATIVE == event->deadlinetype && event->due_ns == 0){
+            clock_gettime(CLOCK_REALTIME, &now);
+            event->due_ns = evdsptc_timespec_tons(&now) + evdsptc_timespec_tons(&event->deadline);
+        }else if(EVDSPTC_TIMERTYPE_IMMEDIATE == event->deadlinetype && event->due_ns == 0){
+            // with the aging, an event without deadline is due once it has waited for the aging, so that it is not starved.
+            if(context->priority_aging.tv_sec != 0 || context->priority_aging.tv_nsec != 0){
+                clock_gettime(CLOCK_REALTIME, &now);
+                event->due_ns = evdsptc_timespec_tons(&now) + evdsptc_timespec_tons(&context->priority_aging);
+            }
+        }
+        evdsptc_edf_push(context, event);
+        return;
+    }
+    if(context->priority_aging.tv_sec != 0 || context->priority_aging.tv_nsec != 0)
+        clock_gettime(CLOCK_MONOTONIC, &event->queued_time);
+    evdsptc_list_push(evdsptc_ready_list(context, event->priority), &event->listelem);
+    __atomic_store_n(&context->priority_bitmap, context->priority_bitmap | (1U << event->priority), __ATOMIC_RELAXED);
+}
+
+// pops the head of the highest non-empty level, or the oldest head of the lower levels that waited longer than the aging.
+static evdsptc_event_t* evdsptc_ready_pop(evdsptc_context_t* context){
+    unsigned int bitmap = context->priority_bitmap;
+    unsigned int lower;
+    evdsptc_event_t* head;
+    evdsptc_event_t* oldest = NULL;
+    evdsptc_event_t* event;
+    evdsptc_list_t* list;
+    struct timespec now;
+    struct timespec due;
+    int priority;
+    int level;
+
+    if(context->sched_policy == EVDSPTC_SCHEDPOLICY_EDF) return evdsptc_edf_pop(context);
+    if(bitmap == 0) return NULL;
+    priority = 31 - __builtin_clz(bitmap);
+    lower = bitmap & ((1U << priority) - 1);
+    if(lower != 0 && (context->priority_aging.tv_sec != 0 || context->priority_aging.tv_nsec != 0)){
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        while(lower != 0){
+            level = __builtin_ctz(lower);
+            lower &= lower - 1;
+            head = (evdsptc_event_t*)evdsptc_listelem_next(evdsptc_list_iterator(evdsptc_ready_list(context, level)));
+            due = evdsptc_timespec_add(&head->queued_time, &context->priority_aging);
+            if(evdsptc_timespec_compare(&due, &now) > 0) continue;
+            if(oldest == NULL || evdsptc_timespec_compare(&head->queued_time, &oldest->queued_time) < 0) oldest = head;
+        }
+        if(oldest != NULL) priority = oldest->priority;
+    }
+    list = evdsptc_ready_list(context, priority);
+    event = (evdsptc_event_t*)evdsptc_list_pop(list);
+    if(evdsptc_list_isempty(list)) __atomic_store_n(&context->priority_bitmap, bitmap & ~(1U << priority), __ATOMIC_RELAXED);
+    return event;
+}
+
+static unsigned int evdsptc_hashkey (unsigned long long int key){
+    return (unsigned int)((key * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+// returns the worker owning the key of the event, or NULL if the event can run on any worker.
+static evdsptc_worker_t* evdsptc_keyed_owner (evdsptc_context_t* context, evdsptc_event_t* event){
+    if(!event->keyed || context->type != EVDSPTC_TYPE_NORMAL || context->threads_max < 2) return NULL;
+    return &context->workers[evdsptc_hashkey(event->key) % (unsigned int)context->threads_max];
+}
+
+// pending coalescing events are chained in a hash table by their coalesce keys. context->mtx must be locked for the helpers below.
+static evdsptc_event_t** evdsptc_coalesce_find (evdsptc_context_t* context, unsigned long long int key){
+    evdsptc_event_t** slot;
+
+    if(context->coalesce_capacity == 0) return NULL;
+    slot = &context->coalesce_table[evdsptc_hashkey(key) & (context->coalesce_capacity - 1)];
+    while(*slot != NULL && (*slot)->coalesce_key != key) slot = &(*slot)->coalesce_next;
+    return (*slot != NULL) ? slot : NULL;
+}
+
+// makes room for one more pending coalescing event, keeping the load factor at most 1.
+static bool evdsptc_coalesce_reserve (evdsptc_context_t* context){
+    evdsptc_event_t** table;
+    evdsptc_event_t* event;
+    int capacity = (context->coalesce_capacity == 0) ? 64 : context->coalesce_capacity * 2;
+    int i;
+
+    if(context->coalesce_num < context->coalesce_capacity) return true;
+    table = (evdsptc_event_t**)calloc(capacity, sizeof(evdsptc_event_t*));
+    if(table == NULL) return false;
+    for(i = 0; i < context->coalesce_capacity; i++){
+        while(NULL != (event = context->coalesce_table[i])){
+            context->coalesce_table[i] = event->coalesce_next;
+            event->coalesce_next = table[evdsptc_hashkey(event->coalesce_key) & (capacity - 1)];
+            table[evdsptc_hashkey(event->coalesce_key) & (capacity - 1)] = event;
+        }
+    }
+    free(context->coalesce_table);
+    context->coalesce_table = table;
+    context->coalesce_capacity = capacity;
+    return true;
+}
+
+static void evdsptc_coalesce_insert (evdsptc_context_t* context, evdsptc_event_t* event){
+    evdsptc_event_t** slot = &context->coalesce_table[evdsptc_hashkey(event->coalesce_key) & (context->coalesce_capacity - 1)];
+
+    event->coalesce_next = *slot;
+    *slot = event;
+    event->coalescing = true;
+    context->coalesce_num++;
+}
+
+// puts the event in place of the pending event, which inherits its queue, priority and deadline.
+static void evdsptc_coalesce_replace (evdsptc_context_t* context, evdsptc_event_t** slot, evdsptc_event_t* event){
+    evdsptc_event_t* pending = *slot;
+
+    event->priority = pending->priority;
+    event->deadline = pending->deadline;
+    event->deadlinetype = pending->deadlinetype;
+    event->due_ns = pending->due_ns;
+    event->sequence = pending->sequence;
+    event->queued_time = pending->queued_time;
+    event->counted = pending->counted;
+    pending->counted = false;
+    if(pending->listelem.root != NULL){
+        evdsptc_listelem_insertnext(&pending->listelem, &event->listelem);
+        evdsptc_listelem_remove(&pending->listelem);
+    }else{
+        context->edf_heap[pending->heap_index] = event;
+        event->heap_index = pending->heap_index;
+    }
+    event->coalesce_next = pending->coalesce_next;
+    *slot = event;
+    event->coalescing = true;
+    pending->coalescing = false;
+}
+
+// removes the dequeued event from the hash table, so that the next post with its key is queued.
+static void evdsptc_coalesce_release (evdsptc_context_t* context, evdsptc_event_t* event){
+    evdsptc_event_t** slot;
+
+    if(!event->coalescing) return;
+    slot = evdsptc_coalesce_find(context, event->coalesce_key);
+    *slot = event->coalesce_next;
+    event->coalescing = false;
+    context->coalesce_num--;
+}
+
+// pops expired timer events, the keyed events of the calling worker and then queued events, up to the batch size.
+// expired keyed events are passed to their owners. context->mtx must be locked.
+static int evdsptc_dequeue(evdsptc_context_t* context, evdsptc_event_t** events){
+    evdsptc_worker_t* worker = (evdsptc_current_worker != NULL && evdsptc_current_worker->context == context) ? evdsptc_current_worker : NULL;
+    evdsptc_worker_t* owner;
+    int n = 0;
+    int i;
+
+    while(n < context->batch_size && NULL != (events[n] = evdsptc_timer_popexpired(context))){
+        if(NULL == (owner = evdsptc_keyed_owner(context, events[n]))) n++;
+        else if(EVDSPTC_ERROR_NONE != evdsptc_keyed_push(context, owner, events[n])) evdsptc_event_drop(context, events[n]);
+    }
+    while(n < context->batch_size && worker != NULL && NULL != (events[n] = (evdsptc_event_t*)evdsptc_list_pop(&worker->keyed))) n++;
+    while(n < context->batch_size && NULL != (events[n] = evdsptc_ready_pop(context))) n++;
+    if(context->coalesce_num > 0){
+        for(i = 0; i < n; i++) evdsptc_coalesce_release(context, events[i]);
+    }
+    return n;
+}
+
+static void* evdsptc_lockfree_routine(evdsptc_context_t* context){
+    evdsptc_event_t* events[EVDSPTC_MAX_BATCH_SIZE];
+    evdsptc_event_t* event;
+    struct timespec* nearest;
+    int n;
+
+    while(__atomic_load_n(&context->state, __ATOMIC_SEQ_CST) == EVDSPTC_STATUS_RUNNING){
+        n = 0;
+        if(0 != __atomic_load_n(&context->timer_num, __ATOMIC_RELAXED) || 0 != __atomic_load_n(&context->priority_bitmap, __ATOMIC_RELAXED)){
+            pthread_mutex_lock(&context->mtx);
+            n = evdsptc_dequeue(context, events);
+            pthread_mutex_unlock(&context->mtx);
+        }
+        while(n < context->batch_size && NULL != (events[n] = (evdsptc_event_t*)evdsptc_mpsc_pop(context))) n++;
+        if(n > 0){
+            evdsptc_events_run(context, events, n);
+            continue;
+        }
+        if(!evdsptc_mpsc_isempty(context)){
+            sched_yield();
+            continue;
+        }
+
+        __atomic_store_n(&context->mpsc_parked, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_lock(&context->mtx);
+        if(context->mpsc_parked && context->state == EVDSPTC_STATUS_RUNNING && evdsptc_mpsc_isempty(context) && evdsptc_ready_isempty(context) && !evdsptc_timer_hasexpired(context)){
+            if(NULL == (nearest = evdsptc_timer_nearest(context))) pthread_cond_wait(&context->cv, &context->mtx);
+            else pthread_cond_timedwait(&context->cv, &context->mtx, nearest);
+        }
+        __atomic_store_n(&context->mpsc_parked, 0, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&context->mtx);
+    }
+
+    while(__atomic_load_n(&context->mpsc_producers, __ATOMIC_SEQ_CST) != 0) sched_yield();
+    while(!evdsptc_mpsc_isempty(context)){
+        event = (evdsptc_event_t*)evdsptc_mpsc_pop(context);
+        if(event == NULL) sched_yield();
+        else{
+            EVDSPTC_TRACE("canceling event %p for finalizing ...", event); 
+            evdsptc_event_drop(context, event);
+        }
+    }
+    return NULL;
+}
+
+// pushes the worker on top of the idle stack. context->mtx must be locked.
+static void evdsptc_worker_park(evdsptc_worker_t* worker){
+    worker->notified = false;
+    evdsptc_list_push(&worker->context->idle_list, &worker->listelem);
+    __atomic_add_fetch(&worker->context->idle_num, 1, __ATOMIC_SEQ_CST);
+}
+
+static void evdsptc_worker_unpark(evdsptc_worker_t* worker){
+    if(worker->notified) return;
+    evdsptc_listelem_remove(&worker->listelem);
+    __atomic_sub_fetch(&worker->context->idle_num, 1, __ATOMIC_SEQ_CST);
+}
+
+static void evdsptc_worker_sleep(evdsptc_worker_t* worker, struct timespec* abstime){
+    evdsptc_worker_park(worker);
+    if(abstime == NULL) pthread_cond_wait(&worker->cv, &worker->context->mtx);
+    else pthread_cond_timedwait(&worker->cv, &worker->context->mtx, abstime);
+    evdsptc_worker_unpark(worker);
+}
+
+// wakes up the worker if it is parked. context->mtx must be locked.
+static void evdsptc_worker_notify(evdsptc_worker_t* worker){
+    if(worker->listelem.root == NULL) return;
+    evdsptc_listelem_remove(&worker->listelem);
+    __atomic_sub_fetch(&worker->context->idle_num, 1, __ATOMIC_SEQ_CST);
+    worker->notified = true;
+    pthread_cond_signal(&worker->cv);
+}
+
+// wakes up to n workers, most recently parked first. context->mtx must be locked.
+static void evdsptc_worker_wakeup(evdsptc_context_t* context, int n){
+    evdsptc_worker_t* worker;
+
+#ifdef EVDSPTC_BROADCAST_WAKEUP
+    // wakes all the idle workers as pthread_cond_broadcast did, as a baseline of the benchmarks.
+    n = context->threads_max;
+#endif
+    while(n-- > 0){
+        worker = (evdsptc_worker_t*)evdsptc_list_getlast(&context->idle_list);
+        if(worker == NULL) break;
+        evdsptc_worker_notify(worker);
+    }
+}
+
+// sleeps like evdsptc_worker_sleep, but wakes at retire at the latest. returns true if the worker of
+// an elastic pool timed out without being notified and can retire. context->mtx must be locked.
+static bool evdsptc_worker_sleepidle(evdsptc_worker_t* worker, struct timespec* retire){
+    evdsptc_context_t* context = worker->context;
+    struct timespec* abstime = evdsptc_timer_nearest(context);
+    struct timespec now;
+    bool notified;
+
+    // the last thread keeps waiting for pending timers.
+    if(context->threads_num <= context->threads_min || (context->threads_num == 1 && abstime != NULL)){
+        evdsptc_worker_sleep(worker, abstime);
+        return false;
+    }
+    if(abstime == NULL || evdsptc_timespec_compare(retire, abstime) < 0) abstime = retire;
+    evdsptc_worker_park(worker);
+    pthread_cond_timedwait(&worker->cv, &context->mtx, abstime);
+    notified = worker->notified;
+    evdsptc_worker_unpark(worker);
+
+    if(notified) return false;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return evdsptc_timespec_compare(retire, &now) <= 0;
+}
+
+// the owner handles its own deque from the head in posted order.
+static evdsptc_event_t* evdsptc_worker_popown(evdsptc_worker_t* worker){
+    evdsptc_listelem_t* first;
+
+    if(__atomic_load_n(&worker->depth, __ATOMIC_RELAXED) == 0) return NULL;
+    pthread_mutex_lock(&worker->mtx);
+    first = evdsptc_list_pop(&worker->deque);
+    if(first != NULL) __atomic_sub_fetch(&worker->depth, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&worker->mtx);
+    return (evdsptc_event_t*)first;
+}
+
+// thieves take the tail, the event the owner would handle last.
+static evdsptc_event_t* evdsptc_worker_steal(evdsptc_worker_t* worker){
+    evdsptc_context_t* context = worker->context;
+    evdsptc_worker_t* victim;
+    evdsptc_listelem_t* last = NULL;
+    int i;
+
+    for(i = 1; i < context->threads_num && last == NULL; i++){
+        victim = &context->workers[(worker->index + i) % context->threads_num];
+        if(__atomic_load_n(&victim->depth, __ATOMIC_RELAXED) == 0) continue;
+        pthread_mutex_lock(&victim->mtx);
+        last = evdsptc_list_getlast(&victim->deque);
+        if(last != NULL){
+            evdsptc_listelem_remove(last);
+            __atomic_sub_fetch(&victim->depth, 1, __ATOMIC_SEQ_CST);
+        }
+        pthread_mutex_unlock(&victim->mtx);
+    }
+    return (evdsptc_event_t*)last;
+}
+
+static bool evdsptc_workers_haswork(evdsptc_context_t* context){
+    int i;
+    for(i = 0; i < context->threads_num; i++){
+        if(__atomic_load_n(&context->workers[i].depth, __ATOMIC_SEQ_CST) > 0) return true;
+    }
+    return false;
+}
+
+static void* evdsptc_workstealing_routine(evdsptc_worker_t* worker){
+    evdsptc_context_t* context = worker->context;
+    evdsptc_event_t* event;
+    struct timespec* nearest;
+
+    while(__atomic_load_n(&context->state, __ATOMIC_SEQ_CST) == EVDSPTC_STATUS_RUNNING){
+        event = NULL;
+        if(0 != __atomic_load_n(&context->timer_num, __ATOMIC_RELAXED)){
+            pthread_mutex_lock(&context->mtx);
+            event = evdsptc_timer_popexpired(context);
+            pthread_mutex_unlock(&context->mtx);
+        }
+        if(event == NULL && 1U < __atomic_load_n(&context->priority_bitmap, __ATOMIC_RELAXED)){
+            pthread_mutex_lock(&context->mtx);
+            if(NULL != (event = evdsptc_ready_pop(context))) evdsptc_coalesce_release(context, event);
+            pthread_mutex_unlock(&context->mtx);
+        }
+        if(event == NULL) event = evdsptc_worker_popown(worker);
+        if(event == NULL && 0 != __atomic_load_n(&context->priority_bitmap, __ATOMIC_RELAXED)){
+            pthread_mutex_lock(&context->mtx);
+            if(NULL != (event = evdsptc_ready_pop(context))) evdsptc_coalesce_release(context, event);
+            pthread_mutex_unlock(&context->mtx);
+        }
+        if(event == NULL) event = evdsptc_worker_steal(worker);
+        if(event != NULL){
+            evdsptc_event_run(context, event);
+            continue;
+        }
+
+        pthread_mutex_lock(&context->mtx);
+        evdsptc_worker_park(worker);
+        if(context->state == EVDSPTC_STATUS_RUNNING && evdsptc_ready_isempty(context) && !evdsptc_workers_haswork(context) && !evdsptc_timer_hasexpired(context)){
+            if(NULL == (nearest = evdsptc_timer_nearest(context))) pthread_cond_wait(&worker->cv, &context->mtx);
+            else pthread_cond_timedwait(&worker->cv, &context->mtx, nearest);
+        }
+        evdsptc_worker_unpark(worker);
+        pthread_mutex_unlock(&context->mtx);
+    }
+    return NULL;
+}
+
+// moves newly posted events into the period slots and takes the events due on the current tick.
+static void evdsptc_period_collect (evdsptc_context_t* context, evdsptc_list_t* due){
+    unsigned long long int tick = context->period_count;
+    evdsptc_list_t* slot = &context->period_slots[tick % EVDSPTC_PERIOD_SLOTS];
+    evdsptc_list_t later;
+    evdsptc_event_t* event;
+    unsigned long long int divisor;
+
+    while(NULL != (event = evdsptc_ready_pop(context))){
+        divisor = event->rate_divisor;
+        event->next_period = tick + (event->rate_phase + divisor - tick % divisor) % divisor;
+        evdsptc_list_push(&context->period_slots[event->next_period % EVDSPTC_PERIOD_SLOTS], &event->listelem);
+    }
+
+    // a slot also holds events whose divisor is longer than the slot ring. they stay for a later lap.
+    evdsptc_list_init(&later);
+    while(NULL != (event = (evdsptc_event_t*)evdsptc_list_pop(slot))){
+        if(event->next_period == tick) evdsptc_list_push(due, &event->listelem);
+        else evdsptc_list_push(&later, &event->listelem);
+    }
+    while(NULL != (event = (evdsptc_event_t*)evdsptc_list_pop(&later))) evdsptc_list_push(slot, &event->listelem);
+}
+
+// puts events handled on the current tick back into the slot of their next period.
+static void evdsptc_period_reschedule (evdsptc_context_t* context, evdsptc_list_t* handled){
+    evdsptc_event_t* event;
+
+    while(NULL != (event = (evdsptc_event_t*)evdsptc_list_pop(handled))){
+        event->next_period += event->rate_divisor;
+        evdsptc_list_push(&context->period_slots[event->next_period % EVDSPTC_PERIOD_SLOTS], &event->listelem);
+    }
+}
+
+// records the statistics of the tick and sets the next wakeup. the tick overruns if it ends after the next boundary.
+static void evdsptc_period_close (evdsptc_context_t* context){
+    evdsptc_periodstats_t* stats = context->period_stats;
+    long long int interval_ns = context->interval.tv_sec * 1000LL * 1000LL * 1000LL + context->interval.tv_nsec;
+    long long int late;
+    unsigned long long int missed;
+    struct timespec nominal;
+    struct timespec skipped;
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    evdsptc_histogram_record(&stats->latency, evdsptc_timespec_diffns(&context->period_next, &context->period_woken));
+    evdsptc_histogram_record(&stats->exec, evdsptc_timespec_diffns(&context->period_woken, &now));
+    stats->cycles++;
+
+    nominal = evdsptc_timespec_add(&context->period_next, &context->interval);
+    late = evdsptc_timespec_diffns(&nominal, &now);
+    __atomic_store_n(&context->period_overrun, 0 < late, __ATOMIC_RELAXED);
+    context->period_next = nominal;
+    if(late <= 0) return;
+
+    stats->overruns++;
+    if(context->overrun_policy == EVDSPTC_OVERRUNPOLICY_SKIP && 0 < interval_ns){
+        missed = late / interval_ns + 1;
+        skipped.tv_sec = (time_t)((missed * interval_ns) / (1000LL * 1000LL * 1000LL));
+        skipped.tv_nsec = (long)((missed * interval_ns) % (1000LL * 1000LL * 1000LL));
+        context->period_next = evdsptc_timespec_add(&nominal, &skipped);
+        stats->missed += missed;
+    }else if(context->overrun_policy == EVDSPTC_OVERRUNPOLICY_SHIFT){
+        context->period_next = evdsptc_timespec_add(&now, &context->interval);
+    }
+}
+
+// waits at the end of the tick until all the workers finish it. the last one to arrive closes the tick
+// and sets the next wakeup. returns false if the dispatcher is destroyed before the tick is closed.
+static bool evdsptc_period_wait (evdsptc_context_t* context, struct timespec* next){
+    unsigned long long int tick = context->period_count;
+
+    if(++context->period_arrived == context->threads_num){
+        context->period_arrived = 0;
+        evdsptc_period_reschedule(context, &context->period_handled);
+        evdsptc_period_close(context);
+        __atomic_store_n(&context->period_count, context->period_count + 1, __ATOMIC_RELAXED);
+        pthread_cond_broadcast(&context->cv);
+    }else{
+        while(tick == context->period_count && context->state == EVDSPTC_STATUS_RUNNING) pthread_cond_wait(&context->cv, &context->mtx);
+    }
+    if(tick == context->period_count){
+        evdsptc_period_reschedule(context, &context->period_handled);
+        return false;
+    }
+    *next = context->period_next;
+    return true;
+}
+
+static void* evdsptc_periodic_routine(evdsptc_context_t* context){
+    evdsptc_event_t* event;
+    struct timespec next;
+    bool is_done;
+    int ret;
+
+    pthread_mutex_lock(&context->mtx);
+    next = context->period_next;
+    pthread_mutex_unlock(&context->mtx);
+
+    while(1){
+        ret = EINTR;
+        while(ret == EINTR) ret = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+        pthread_mutex_lock(&context->mtx);
+        if(context->state != EVDSPTC_STATUS_RUNNING) break;
+        if(context->period_collected == context->period_count){
+            clock_gettime(CLOCK_MONOTONIC, &context->period_woken);
+            evdsptc_period_collect(context, &context->period_due);
+            context->period_collected++;
+        }
+        // the due events are shared by the workers woken on this tick.
+        while(NULL != (event = (evdsptc_event_t*)evdsptc_list_pop(&context->period_due))){
+            pthread_mutex_unlock(&context->mtx);
+            is_done = evdsptc_event_run(context, event);
+            pthread_mutex_lock(&context->mtx);
+            if(!is_done) evdsptc_list_push(&context->period_handled, &event->listelem);
+        }
+        if(!evdsptc_period_wait(context, &next)) break;
+        pthread_mutex_unlock(&context->mtx);
+    }
+    pthread_mutex_unlock(&context->mtx);
+    return NULL;
+}
+
+#ifdef __linux__
+// wakes up the reactor thread if it is blocked in epoll_wait. context->mtx must be locked.
+static void evdsptc_reactor_wakeup(evdsptc_context_t* context){
+    if(__atomic_exchange_n(&context->reactor_polling, false, __ATOMIC_SEQ_CST)) evdsptc_eventfd_signal(context->reactor_fd);
+}
+
+static void* evdsptc_reactor_routine(evdsptc_context_t* context){
+    evdsptc_event_t* events[EVDSPTC_MAX_BATCH_SIZE];
+    struct epoll_event ready[EVDSPTC_REACTOR_EVENTS];
+    struct timespec* nearest;
+    struct timespec now;
+    evdsptc_io_t* io;
+    long long int wait_ns;
+    int timeout_ms;
+    int n;
+    int i;
+
+    while(1){
+        pthread_mutex_lock(&context->mtx);
+        // the I/O events of the last round are handled, so the ios unregistered meanwhile are released.
+        context->reactor_round++;
+        if(context->reactor_waiters > 0) pthread_cond_broadcast(&context->cv);
+        if(context->state != EVDSPTC_STATUS_RUNNING){
+            pthread_mutex_unlock(&context->mtx);
+            break;
+        }
+        timeout_ms = 0;
+        if(0 == (n = evdsptc_dequeue(context, events))){
+            timeout_ms = -1;
+            if(NULL != (nearest = evdsptc_timer_nearest(context))){
+                clock_gettime(CLOCK_REALTIME, &now);
+                wait_ns = evdsptc_timespec_diffns(&now, nearest);
+                // rounds up, so that the timer has expired when epoll_wait returns. far timers wake up early and wait again.
+                if(wait_ns <= 0) timeout_ms = 0;
+                else if(wait_ns / 1000000 >= INT_MAX) timeout_ms = INT_MAX;
+                else timeout_ms = (int)((wait_ns + 999999) / 1000000);
+            }
+            if(timeout_ms != 0) __atomic_store_n(&context->reactor_polling, true, __ATOMIC_SEQ_CST);
+        }
+        pthread_mutex_unlock(&context->mtx);
+        if(n > 0) evdsptc_events_run(context, events, n);
+
+        // polls without blocking while events are queued, so that the I/O is not starved by them.
+        n = epoll_wait(context->epoll_fd, ready, EVDSPTC_REACTOR_EVENTS, timeout_ms);
+        __atomic_store_n(&context->reactor_polling, false, __ATOMIC_SEQ_CST);
+        context->reactor_ready = ready;
+        context->reactor_ready_num = (n < 0) ? 0 : n;
+        for(i = 0; i < context->reactor_ready_num; i++){
+            io = (evdsptc_io_t*)ready[i].data.ptr;
+            if(io == NULL) continue;
+            if((void*)io == (void*)context) evdsptc_eventfd_clear(context->reactor_fd);
+            else io->handler(io, ready[i].events);
+        }
+        context->reactor_ready_num = 0;
+    }
+    return NULL;
+}
+
+static bool evdsptc_reactor_init(evdsptc_context_t* context){
+    struct epoll_event ev;
+
+    context->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    context->reactor_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(context->epoll_fd < 0 || context->reactor_fd < 0) return false;
+    ev.events = EPOLLIN;
+    ev.data.ptr = context;
+    return 0 == epoll_ctl(context->epoll_fd, EPOLL_CTL_ADD, context->reactor_fd, &ev);
+}
+#endif
+
+static void* evdsptc_thread_routine(void* arg){
+    evdsptc_worker_t* worker = (evdsptc_worker_t*)arg;
+    evdsptc_context_t* context = worker->context;
+    evdsptc_event_t* events[EVDSPTC_MAX_BATCH_SIZE];
+    int events_num;
+    bool finalize = false;
+    bool elastic = (context->threads_min < context->threads_max);
+    struct timespec retire;
+
+#ifdef __linux__
+    if(worker->name[0] != '\0') pthread_setname_np(pthread_self(), worker->name);
+#endif
+    evdsptc_current_worker = worker;
+    if(context->type == EVDSPTC_TYPE_LOCKFREE) return evdsptc_lockfree_routine(context);
+    if(context->type == EVDSPTC_TYPE_WORKSTEALING) return evdsptc_workstealing_routine(worker);
+    if(context->type == EVDSPTC_TYPE_PERIODIC) return evdsptc_periodic_routine(context);
+#ifdef __linux__
+    if(context->type == EVDSPTC_TYPE_REACTOR) return evdsptc_reactor_routine(context);
+#endif
+
+    while(1){
+        events_num = 0;
+        pthread_mutex_lock(&context->mtx);
+        if(elastic){
+            clock_gettime(CLOCK_REALTIME, &retire);
+            retire = evdsptc_timespec_add(&retire, &context->idle_timeout);
+        }
+        while(context->state == EVDSPTC_STATUS_RUNNING){
+            if(0 < (events_num = evdsptc_dequeue(context, events))) break;
+            if(!elastic) evdsptc_worker_sleep(worker, evdsptc_timer_nearest(context));
+            else if(evdsptc_worker_sleepidle(worker, &retire)){
+                EVDSPTC_TRACE("retiring worker %p ...", worker); 
+                worker->active = false;
+                context->threads_num--;
+                pthread_mutex_unlock(&context->mtx);
+                return NULL;
+            }
+        }
+        if(context->state != EVDSPTC_STATUS_RUNNING) finalize = true;
+        pthread_mutex_unlock(&context->mtx);
+        
+        if(finalize == true){
+            EVDSPTC_TRACE("finalizing worker %p ...", worker); 
+            break;
+        }
+        evdsptc_events_run(context, events, events_num);
+    }
+    return NULL;
+}
+
+// starts the worker thread with the attributes, or with the default attributes if attr is NULL.
+static int evdsptc_thread_start (evdsptc_context_t* context, int index, evdsptc_threadattr_t* attr){
+    evdsptc_worker_t* worker = &context->workers[index];
+    pthread_attr_t pthread_attr;
+    struct sched_param param;
+#ifdef __linux__
+    cpu_set_t cpuset;
+    int i;
+#endif
+    int ret = 0;
+
+    worker->name[0] = '\0';
+    if(attr == NULL) return pthread_create(&context->th[index], NULL, &evdsptc_thread_routine, (void*)worker);
+
+    if(attr->name != NULL){
+        strncpy(worker->name, attr->name, sizeof(worker->name) - 1);
+        worker->name[sizeof(worker->name) - 1] = '\0';
+    }
+    if(0 != pthread_attr_init(&pthread_attr)) return -1;
+    if(attr->stacksize != 0) ret = pthread_attr_setstacksize(&pthread_attr, attr->stacksize);
+    if(ret == 0 && attr->policy != EVDSPTC_THREADATTR_INHERIT){
+        param.sched_priority = attr->priority;
+        ret = pthread_attr_setinheritsched(&pthread_attr, PTHREAD_EXPLICIT_SCHED);
+        if(ret == 0) ret = pthread_attr_setschedpolicy(&pthread_attr, attr->policy);
+        if(ret == 0) ret = pthread_attr_setschedparam(&pthread_attr, &param);
+    }
+#ifdef __linux__
+    if(ret == 0 && attr->cpus != NULL){
+        CPU_ZERO(&cpuset);
+        for(i = 0; i < attr->cpus_num; i++){
+            if(0 <= attr->cpus[i] && attr->cpus[i] < CPU_SETSIZE) CPU_SET(attr->cpus[i], &cpuset);
+        }
+        ret = pthread_attr_setaffinity_np(&pthread_attr, sizeof(cpuset), &cpuset);
+    }
+#endif
+    if(ret == 0) ret = pthread_create(&context->th[index], &pthread_attr, &evdsptc_thread_routine, (void*)worker);
+    pthread_attr_destroy(&pthread_attr);
+    return ret;
+}
+
+static evdsptc_error_t evdsptc_create_impl (evdsptc_context_t* context,
+        evdsptc_event_callback_t queued_callback,
+        evdsptc_event_callback_t begin_callback,
+        evdsptc_event_callback_t end_callback,
+        int threads_num,
+        int threads_max,
+        evdsptc_type_t type,
+        evdsptc_threadattr_t* attrs,
+        bool manual
+        )
+{
+    evdsptc_error_t ret = EVDSPTC_ERROR_FAIL_CREATE_THREAD;
+    int workers_num = 0;
+    int synced = 0;
+    int i;
+
+    // every failure unwinds through CLEANUP, which frees only what has been set up so far.
+    context->state = EVDSPTC_STATUS_ERROR;
+    context->th = NULL;
+    context->workers = NULL;
+    context->period_slots = NULL;
+    context->period_stats = NULL;
+    // only an event dispatcher driven by evdsptc_dispatch runs without threads.
+    if(threads_num < 0 || threads_max < (manual ? 0 : 1) || threads_max < threads_num || EVDSPTC_MAX_THREADS < threads_max){
+        ret = EVDSPTC_ERROR_INVALID;
+        goto CLEANUP;
+    }
+   
+    ret = EVDSPTC_ERROR_FAIL_INIT_MUTEX;
+    if(0 != pthread_mutex_init(&context->mtx, evdsptc_pmutexattrinitializer)) goto CLEANUP;
+    synced++;
+    ret = EVDSPTC_ERROR_FAIL_INIT_COND;
+    if(0 != pthread_cond_init(&context->cv, NULL)) goto CLEANUP;
+    synced++;
+    if(0 != pthread_cond_init(&context->space_cv, NULL)) goto CLEANUP;
+    synced++;
+    ret = EVDSPTC_ERROR_FAIL_INIT_MUTEX;
+    if(0 != pthread_mutex_init(&context->completion_mtx, evdsptc_pmutexattrinitializer)) goto CLEANUP;
+    synced++;
+
+    context->threads_num = threads_num;
+    context->threads_min = threads_num;
+    context->threads_max = threads_max;
+    // an event dispatcher without threads still has a slot for the threads calling evdsptc_dispatch.
+    context->th = (pthread_t*)calloc(evdsptc_slots_num(context), sizeof(pthread_t));
+    context->workers = (evdsptc_worker_t*)calloc(evdsptc_slots_num(context), sizeof(evdsptc_worker_t));
+    // only periodic event dispatchers carry the period slots and statistics.
+    if(type == EVDSPTC_TYPE_PERIODIC){
+        context->period_slots = (evdsptc_list_t*)calloc(EVDSPTC_PERIOD_SLOTS, sizeof(evdsptc_list_t));
+        context->period_stats = (evdsptc_periodstats_t*)calloc(1, sizeof(evdsptc_periodstats_t));
+    }
+    if(context->th == NULL || context->workers == NULL || (type == EVDSPTC_TYPE_PERIODIC && (context->period_slots == NULL || context->period_stats == NULL))){
+        ret = EVDSPTC_ERROR_FAIL_ALLOC_MEMORY;
+        goto CLEANUP;
+    }
+    
+    pthread_mutex_lock(&context->mtx);
+
+    evdsptc_list_init(&context->list);
+    for(i = 0; i < EVDSPTC_PRIORITY_LEVELS - 1; i++) evdsptc_list_init(&context->priority_list[i]);
+    context->priority_bitmap = 0;
+    context->priority_aging.tv_sec = 0;
+    context->priority_aging.tv_nsec = 0;
+    context->sched_policy = EVDSPTC_SCHEDPOLICY_PRIORITY;
+    context->drop_missed = false;
+    context->edf_heap = NULL;
+    context->edf_num = 0;
+    context->edf_capacity = 0;
+    context->edf_sequence = 0;
+    context->deadline_miss_count = 0;
+    context->coalesce_table = NULL;
+    context->coalesce_capacity = 0;
+    context->coalesce_num = 0;
+    context->bounded = false;
+    context->capacity = 0;
+    context->queued_num = 0;
+    context->high_watermark = 0;
+    context->low_watermark = 0;
+    context->high_callback = NULL;
+    context->low_callback = NULL;
+    context->congested = false;
+    context->space_waiters = 0;
+    context->completion_fd = -1;
+    evdsptc_list_init(&context->completion_list);
+    context->completion_signaled = false;
+    context->ready_fd = -1;
+    context->ready_signaled = false;
+    context->epoll_fd = -1;
+    context->reactor_fd = -1;
+    context->reactor_polling = false;
+    context->reactor_ready = NULL;
+    context->reactor_ready_num = 0;
+    context->reactor_round = 0;
+    context->reactor_waiters = 0;
+    evdsptc_list_init(&context->timer_list);
+    context->timer_backend = EVDSPTC_TIMERBACKEND_LIST;
+    context->timer_wheel = NULL;
+    context->timer_num = 0;
+    evdsptc_list_init(&context->timer_monolist);
+    context->timer_monofd = -1;
+    context->timer_realfd = -1;
+    context->timer_kickfd = -1;
+    context->timer_threaded = false;
+    context->batch_size = 1;
+    context->instrumented = false;
+    context->event_stats = NULL;
+    for(i = 0; context->period_slots != NULL && i < EVDSPTC_PERIOD_SLOTS; i++) evdsptc_list_init(&context->period_slots[i]);
+    evdsptc_list_init(&context->period_due);
+    evdsptc_list_init(&context->period_handled);
+    context->period_count = 0;
+    context->period_collected = 0;
+    context->period_arrived = 0;
+    context->period_overrun = false;
+    context->overrun_policy = EVDSPTC_OVERRUNPOLICY_SHIFT;
+    evdsptc_mpsc_init(context);
+    for(i = 0; i < context->threads_max; i++){
+        context->workers[i].context = context;
+        context->workers[i].index = i;
+        if(0 != pthread_mutex_init(&context->workers[i].mtx, evdsptc_pmutexattrinitializer)){
+            context->threads_num = 0;
+            ret = EVDSPTC_ERROR_FAIL_INIT_MUTEX;
+            goto ERROR;
+        }
+        if(0 != pthread_cond_init(&context->workers[i].cv, NULL)){
+            pthread_mutex_destroy(&context->workers[i].mtx);
+            context->threads_num = 0;
+            ret = EVDSPTC_ERROR_FAIL_INIT_COND;
+            goto ERROR;
+        }
+        workers_num = i + 1;
+        evdsptc_list_init(&context->workers[i].deque);
+        context->workers[i].depth = 0;
+        evdsptc_list_init(&context->workers[i].keyed);
+    }
+    evdsptc_list_init(&context->idle_list);
+    context->idle_num = 0;
+    context->state = EVDSPTC_STATUS_RUNNING;
+    context->queued_callback = queued_callback;
+    context->begin_callback = begin_callback;
+    context->end_callback = end_callback; 
+    context->type = type;
+#ifdef __linux__
+    if(type == EVDSPTC_TYPE_REACTOR && !evdsptc_reactor_init(context)){
+        context->threads_num = 0;
+        ret = EVDSPTC_ERROR_FAIL_INIT_IO;
+        goto ERROR;
+    }
+#endif
+
+    for(i = 0; i < context->threads_num; i++){
+        if(0 != evdsptc_thread_start(context, i, attrs != NULL ? &attrs[i] : NULL)){
+            context->threads_num = i;
+            ret = EVDSPTC_ERROR_FAIL_CREATE_THREAD;
+            goto ERROR;
+        }
+        context->workers[i].active = true;
+        context->workers[i].joinable = true;
+    }
+    // periodic threads read the first wakeup after the mutex is released, so all of them share it.
+    if(type == EVDSPTC_TYPE_PERIODIC){
+        clock_gettime(CLOCK_MONOTONIC, &context->period_next);
+        context->period_next = evdsptc_timespec_add(&context->period_next, &context->interval);
+    }
+
+    pthread_mutex_unlock(&context->mtx);
+    return EVDSPTC_ERROR_NONE;
+
+ERROR:
+    // the threads already started see the error state and exit. periodic threads wake up at once.
+    context->state = EVDSPTC_STATUS_ERROR;
+    clock_gettime(CLOCK_MONOTONIC, &context->period_next);
+    pthread_cond_broadcast(&context->cv);
+    evdsptc_worker_wakeup(context, context->threads_num);
+    pthread_mutex_unlock(&context->mtx);
+    for(i = 0; i < context->threads_num; i++) pthread_join(context->th[i], NULL);
+#ifdef __linux__
+    if(0 <= context->epoll_fd) close(context->epoll_fd);
+    if(0 <= context->reactor_fd) close(context->reactor_fd);
+    context->epoll_fd = -1;
+    context->reactor_fd = -1;
+#endif
+CLEANUP:
+    for(i = 0; i < workers_num; i++){
+        pthread_mutex_destroy(&context->workers[i].mtx);
+        pthread_cond_destroy(&context->workers[i].cv);
+    }
+    free(context->th);
+    free(context->workers);
+    free(context->period_slots);
+    free(context->period_stats);
+    context->th = NULL;
+    context->workers = NULL;
+    context->period_slots = NULL;
+    context->period_stats = NULL;
+    context->threads_num = 0;
+    context->threads_min = 0;
+    context->threads_max = 0;
+    if(synced > 3) pthread_mutex_destroy(&context->completion_mtx);
+    if(synced > 2) pthread_cond_destroy(&context->space_cv);
+    if(synced > 1) pthread_cond_destroy(&context->cv);
+    if(synced > 0) pthread_mutex_destroy(&context->mtx);
+    return ret;
+}
+
+evdsptc_error_t evdsptc_create (evdsptc_context_t* context,
+        evdsptc_event_callback_t queued_callback,
+        evdsptc_event_callback_t begin_callback,
+        evdsptc_event_callback_t end_callback)
+{
+    return evdsptc_create_impl(context, queued_callback, begin_callback, end_callback, 1, 1, EVDSPTC_TYPE_NORMAL, NULL, false);
+} 
+
+evdsptc_error_t evdsptc_create_manual (evdsptc_context_t* context,
+        evdsptc_event_callback_t queued_callback,
+        evdsptc_event_callback_t begin_callback,
+        evdsptc_event_callback_t end_callback)
+{
+    return evdsptc_create_impl(context, queued_callback, begin_callback, end_callback, 0, 0, EVDSPTC_TYPE_NORMAL, NULL, true);
+} 
+
+evdsptc_error_t evdsptc_create_threadpool (evdsptc_context_t* context,
+        evdsptc_event_callback_t queued_callback,
+        evdsptc_event_callback_t begin_callback,
+        evdsptc_event_callback_t end_callback,
+        int threads_num)
+{
+    return evdsptc_create_impl(context, queued_callback, begin_callback, end_callback, threads_num, threads_num, EVDSPTC_TYPE_NORMAL, NULL, false);
+} 
+
+evdsptc_error_t evdsptc_create_lockfree (evdsptc_context_t* context,
+        evdsptc_event_callback_t queued_callback,
+        evdsptc_event_callback_t begin_callback,
+        evdsptc_event_callback_t end_callback)
+{
+    return evdsptc_create_impl(context, queued_callback, begin_callback, end_callback, 1, 1, EVDSPTC_TYPE_LOCKFREE, NULL, false);
+} 
+
+evdsptc_error_t evdsptc_create_reactor (evdsptc_context_t* context,
+        evdsptc_event_callback_t queued_callback,
+        evdsptc_event_callback_t begin_callback,
+        evdsptc_event_callback_t end_callback)
+{
+#ifdef __linux__
+    return evdsptc_create_impl(context, queued_callback, begin_callback, end_callback, 1, 1, EVDSPTC_TYPE_REACTOR, NULL, false);
+#else
+    return EVDSPTC_ERROR_INVALID;
+#endif
+} 
+
+evdsptc_error_t evdsptc_create_workstealing (evdsptc_context_t* context,
+        evdsptc_event_callback_t queued_callback,
+        evdsptc_event_callback_t begin_callback,
+        evdsptc_event_callback_t end_callback,
+        int threads_num)
+{
+    return evdsptc_create_impl(context, queued_callback, begin_callback, end_callback, threads_num, threads_num, EVDSPTC_TYPE_WORKSTEALING, NULL, false);
+} 
+
+evdsptc_error_t evdsptc_create_periodic (evdsptc_context_t* context,
+        evdsptc_event_callback_t queued_callback,
+        evdsptc_event_callback_t begin_callback,
+        evdsptc_event_callback_t end_callback,
+        struct timespec* interval)
+{
+    context->interval = *interval;
+    return evdsptc_create_impl(context, queued_callback, begin_callback, end_callback, 1, 1, EVDSPTC_TYPE_PERIODIC, NULL, false);
+} 
+
+evdsptc_error_t evdsptc_create_periodic_threadpool (evdsptc_context_t* context,
+        evdsptc_event_callback_t queued_callback,
+        evdsptc_event_callback_t begin_callback,
+        evdsptc_event_callback_t end_callback,
+        struct timespec* interval,
+        int threads_num)
+{
+    context->interval = *interval;
+    return evdsptc_create_impl(context, queued_callback, begin_callback, end_callback, threads_num, threads_num, EVDSPTC_TYPE_PERIODIC, NULL, false);
+} 
+
+evdsptc_error_t evdsptc_create_elastic (evdsptc_context_t* context,
+        evdsptc_event_callback_t queued_callback,
+        evdsptc_event_callback_t begin_callback,
+        evdsptc_event_callback_t end_callback,
+        int min_threads,
+        int max_threads,
+        struct timespec* idle_timeout)
+{
+    if(idle_timeout == NULL || idle_timeout->tv_sec < 0 || idle_timeout->tv_nsec < 0) return EVDSPTC_ERROR_INVALID;
+    context->idle_timeout = *idle_timeout;
+    return evdsptc_create_impl(context, queued_callback, begin_callback, end_callback, min_threads, max_threads, EVDSPTC_TYPE_NORMAL, NULL, false);
+} 
+
+evdsptc_error_t evdsptc_create_ex (evdsptc_context_t* context,
+        evdsptc_event_callback_t queued_callback,
+        evdsptc_event_callback_t begin_callback,
+        evdsptc_event_callback_t end_callback,
+        evdsptc_type_t type,
+        int threads_num,
+        struct timespec* interval,
+        evdsptc_threadattr_t* attrs)
+{
+    if(type != EVDSPTC_TYPE_NORMAL && type != EVDSPTC_TYPE_PERIODIC && type != EVDSPTC_TYPE_LOCKFREE &&
+            type != EVDSPTC_TYPE_WORKSTEALING && type != EVDSPTC_TYPE_REACTOR) return EVDSPTC_ERROR_INVALID;
+    if((type == EVDSPTC_TYPE_LOCKFREE || type == EVDSPTC_TYPE_REACTOR) && threads_num != 1) return EVDSPTC_ERROR_INVALID;
+    if(type == EVDSPTC_TYPE_PERIODIC){
+        if(interval == NULL) return EVDSPTC_ERROR_INVALID;
+        context->interval = *interval;
+    }
+    return evdsptc_create_impl(context, queued_callback, begin_callback, end_callback, threads_num, threads_num, type, attrs, false);
+} 
+
+void evdsptc_threadattr_init (evdsptc_threadattr_t* attr){
+    attr->cpus = NULL;
+    attr->cpus_num = 0;
+    attr->policy = EVDSPTC_THREADATTR_INHERIT;
+    attr->priority = 0;
+    attr->stacksize = 0;
+    attr->name = NULL;
+}
+
+// cancels the queued events. the events handed back through the completion queue are removed from the list,
+// and the others are left to be destroyed with the context.
+static void evdsptc_list_cancel (evdsptc_context_t* context, evdsptc_list_t* list){
+    evdsptc_listelem_t* i = evdsptc_list_iterator(list);
+    evdsptc_listelem_t copied;
+    evdsptc_event_t* e;
+
+    while(evdsptc_listelem_hasnext(i)){
+        i = evdsptc_listelem_next(i);
+        e = (evdsptc_event_t*)i;
+        if(evdsptc_completion_isqueued(context, e)){
+            copied = *i;
+            evdsptc_listelem_remove(i);
+            evdsptc_event_drop(context, e);
+            i = &copied;
+            continue;
+        }
+        e->auto_destruct = false;
+        evdsptc_event_cancel(e);
+    }
+}
+
+evdsptc_error_t evdsptc_cancel (evdsptc_context_t* context){
+    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
+    evdsptc_list_t pending;
+    evdsptc_event_t* event;
+    int n;
+    int i;
+    
+    pthread_mutex_lock(&context->mtx);
+    if(context->state == EVDSPTC_STATUS_RUNNING){
+        context->state = EVDSPTC_STATUS_DESTROYING;
+        __sync_synchronize();
+        pthread_cond_broadcast(&context->cv);
+        pthread_cond_broadcast(&context->space_cv);
+        evdsptc_worker_wakeup(context, context->threads_num);
+        evdsptc_timer_kick(context);
+#ifdef __linux__
+        if(context->type == EVDSPTC_TYPE_REACTOR) evdsptc_reactor_wakeup(context);
+#endif
+    }
+    
+    for(n = 0; n < EVDSPTC_PRIORITY_LEVELS; n++) evdsptc_list_cancel(context, evdsptc_ready_list(context, n));
+    for(n = 0; context->period_slots != NULL && n < EVDSPTC_PERIOD_SLOTS; n++) evdsptc_list_cancel(context, &context->period_slots[n]);
+    evdsptc_list_cancel(context, &context->period_due);
+    evdsptc_list_cancel(context, &context->period_handled);
+    for(n = 0, i = 0; n < context->edf_num; n++){
+        event = context->edf_heap[n];
+        if(evdsptc_completion_isqueued(context, event)){
+            evdsptc_event_drop(context, event);
+            continue;
+        }
+        event->auto_destruct = false;
+        evdsptc_event_cancel(event);
+        context->edf_heap[i++] = event;
+    }
+    context->edf_num = i;
+    for(n = 0; n < context->threads_max; n++) evdsptc_list_cancel(context, &context->workers[n].keyed);
+    // pending timer events are handed back too, while the other ones are left to be destroyed with the context.
+    if(0 <= context->completion_fd){
+        evdsptc_list_init(&pending);
+        evdsptc_timer_takeall(context, &pending);
+        while(NULL != (event = (evdsptc_event_t*)evdsptc_list_pop(&pending))){
+            if(evdsptc_completion_isqueued(context, event)) evdsptc_event_drop(context, event);
+            else evdsptc_timer_insert(context, event);
+        }
+    }
+    pthread_mutex_unlock(&context->mtx);
+
+    if(context->type == EVDSPTC_TYPE_WORKSTEALING){
+        for(n = 0; n < context->threads_num; n++){
+            pthread_mutex_lock(&context->workers[n].mtx);
+            evdsptc_list_cancel(context, &context->workers[n].deque);
+            pthread_mutex_unlock(&context->workers[n].mtx);
+        }
+    }
+   
+    return ret;
+}
+
+evdsptc_error_t evdsptc_destroy (evdsptc_context_t* context, bool join){
+    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
+    void* arg = NULL;
+    int i;
+
+    pthread_mutex_lock(&context->mtx);
+    if(context->state == EVDSPTC_STATUS_RUNNING){
+        context->state = EVDSPTC_STATUS_DESTROYING;
+        __sync_synchronize();
+        pthread_cond_broadcast(&context->cv);
+        pthread_cond_broadcast(&context->space_cv);
+        evdsptc_worker_wakeup(context, context->threads_num);
+        evdsptc_timer_kick(context);
+#ifdef __linux__
+        if(context->type == EVDSPTC_TYPE_REACTOR) evdsptc_reactor_wakeup(context);
+#endif
+    }
+    pthread_mutex_unlock(&context->mtx);
+
+    for(i = 0; i < context->threads_max; i++){
+        if(!context->workers[i].joinable) continue;
+        if(join) pthread_join(context->th[i], &arg);
+        else pthread_detach(context->th[i]);  
+        context->workers[i].joinable = false;
+    }
+    // the timer thread never runs handlers, so it is joined even if the workers are detached.
+    if(context->timer_threaded) pthread_join(context->timer_thread, NULL);
+    context->timer_threaded = false;
+
+    for(i = 0; i < EVDSPTC_PRIORITY_LEVELS; i++) evdsptc_list_destroy(evdsptc_ready_list(context, i));
+    context->priority_bitmap = 0;
+    for(i = 0; context->period_slots != NULL && i < EVDSPTC_PERIOD_SLOTS; i++) evdsptc_list_destroy(&context->period_slots[i]);
+    evdsptc_list_destroy(&context->period_due);
+    evdsptc_list_destroy(&context->period_handled);
+    for(i = 0; i < context->edf_num; i++){
+        if(context->edf_heap[i]->listelem.destructor != NULL) context->edf_heap[i]->listelem.destructor(&context->edf_heap[i]->listelem);
+    }
+    free(context->edf_heap);
+    context->edf_heap = NULL;
+    context->edf_num = 0;
+    context->edf_capacity = 0;
+    free(context->coalesce_table);
+    context->coalesce_table = NULL;
+    context->coalesce_capacity = 0;
+    context->coalesce_num = 0;
+    evdsptc_timer_destroy(context);
+    for(i = 0; i < context->threads_num; i++) evdsptc_list_destroy(&context->workers[i].deque);
+    for(i = 0; i < context->threads_max; i++) evdsptc_list_destroy(&context->workers[i].keyed);
+    context->instrumented = false;
+    free(context->event_stats);
+    context->event_stats = NULL;
+    free(context->period_slots);
+    free(context->period_stats);
+    context->period_slots = NULL;
+    context->period_stats = NULL;
+    // the events left in the completion queue belong to the user.
+    evdsptc_list_init(&context->completion_list);
+    if(0 <= context->completion_fd) close(context->completion_fd);
+    if(0 <= context->ready_fd) close(context->ready_fd);
+    if(0 <= context->epoll_fd) close(context->epoll_fd);
+    if(0 <= context->reactor_fd) close(context->reactor_fd);
+    if(0 <= context->timer_monofd) close(context->timer_monofd);
+    if(0 <= context->timer_realfd) close(context->timer_realfd);
+    if(0 <= context->timer_kickfd) close(context->timer_kickfd);
+    context->completion_fd = -1;
+    context->ready_fd = -1;
+    context->epoll_fd = -1;
+    context->reactor_fd = -1;
+    context->timer_monofd = -1;
+    context->timer_realfd = -1;
+    context->timer_kickfd = -1;
+    // detached threads may still touch their workers.
+    if(join){
+        free(context->th);
+        free(context->workers);
+        context->th = NULL;
+        context->workers = NULL;
+    }
+   
+    return ret;
+}
+
+void evdsptc_event_cancel (evdsptc_event_t* event){
+    if(event->handler == evdsptc_strand_run) evdsptc_strand_cancel((evdsptc_strand_t*)event->param, true);
+    event->is_canceled = true;
+    __sync_synchronize();
+    evdsptc_event_complete(event);
+    EVDSPTC_TRACE("canceling event %p ...", event); 
+    if(event->auto_destruct && event->destructor != NULL){
+        event->destructor(event);
+    }else{
+        event->auto_destruct = true;
+    }
+}
+
+static void evdsptc_listelem_cancel (evdsptc_listelem_t* listelem){
+    evdsptc_event_t* event = (evdsptc_event_t*)listelem;
+    evdsptc_event_cancel (event);
+}
+
+struct timespec evdsptc_timespec_add (struct timespec* a, struct timespec* b){
+    struct timespec ret;
+    ret = *a;
+    ret.tv_sec  += b->tv_sec;
+    ret.tv_nsec += b->tv_nsec;
+    long nsec_is_1sec = 1000L * 1000L * 1000L;
+    while(nsec_is_1sec <= ret.tv_nsec){
+        ret.tv_sec++;
+        ret.tv_nsec -= nsec_is_1sec;
+    }
+    return ret;
+}
+
+// inserts a timer event and returns true if it became the nearest one.
+static bool evdsptc_timer_schedule (evdsptc_context_t* context, evdsptc_event_t* event){
+    struct timespec now;
+    struct timespec* nearest;
+    bool wakeup;
+
+    if(EVDSPTC_TIMERTYPE_RELATIVE == event->timertype){
+        clock_gettime(evdsptc_timer_clock(context, event), &now);
+        event->timer = evdsptc_timespec_add(&now, &event->timer);
+    }
+    if(context->timer_backend == EVDSPTC_TIMERBACKEND_TIMERFD){
+        evdsptc_timer_insert(context, event);
+        return false;
+    }
+    nearest = evdsptc_timer_nearest(context);
+    wakeup = (nearest == NULL || evdsptc_timespec_compare(&event->timer, nearest) < 0);
+    evdsptc_timer_insert(context, event);
+    return wakeup;
+}
+
+// starts a thread on a free worker of the elastic pool. a retired thread of the worker is joined first.
+static bool evdsptc_pool_start (evdsptc_context_t* context, evdsptc_worker_t* worker){
+    if(worker->joinable) pthread_join(context->th[worker->index], NULL);
+    worker->joinable = false;
+    if(0 != evdsptc_thread_start(context, worker->index, NULL)) return false;
+    EVDSPTC_TRACE("starting worker %p ...", worker); 
+    worker->active = true;
+    worker->joinable = true;
+    context->threads_num++;
+    return true;
+}
+
+static bool evdsptc_pool_spawn (evdsptc_context_t* context){
+    int i;
+
+    for(i = 0; i < context->threads_max; i++){
+        if(!context->workers[i].active) return evdsptc_pool_start(context, &context->workers[i]);
+    }
+    return false;
+}
+
+// queues the event to the worker owning its key, and starts the worker if it has retired. context->mtx must be locked.
+static evdsptc_error_t evdsptc_keyed_push (evdsptc_context_t* context, evdsptc_worker_t* owner, evdsptc_event_t* event){
+    if(!owner->active && !evdsptc_pool_start(context, owner)) return EVDSPTC_ERROR_FAIL_CREATE_THREAD;
+    evdsptc_list_push(&owner->keyed, &event->listelem);
+    evdsptc_worker_notify(owner);
+    return EVDSPTC_ERROR_NONE;
+}
+
+// wakes up to n idle workers. an elastic pool starts threads for the rest. context->mtx must be locked.
+static void evdsptc_pool_wakeup (evdsptc_context_t* context, int n){
+    int idle = __atomic_load_n(&context->idle_num, __ATOMIC_SEQ_CST);
+
+#ifdef __linux__
+    if(0 <= context->ready_fd && !context->ready_signaled) evdsptc_eventfd_signal(context->ready_fd);
+#endif
+    context->ready_signaled = true;
+
+    evdsptc_worker_wakeup(context, n);
+    for(n -= idle; 0 < n && context->threads_num < context->threads_max; n--){
+        if(!evdsptc_pool_spawn(context)) break;
+    }
+}
+
+// the queued callback is not called for the events that run strands.
+static void evdsptc_event_queued (evdsptc_context_t* context, evdsptc_event_t* event){
+    if(context->queued_callback != NULL && event->handler != evdsptc_strand_run) context->queued_callback(event);
+}
+
+static void evdsptc_context_wakeup (evdsptc_context_t* context){
+    if(context->type == EVDSPTC_TYPE_NORMAL) evdsptc_pool_wakeup(context, 1);
+    else if(context->type == EVDSPTC_TYPE_WORKSTEALING) evdsptc_worker_wakeup(context, 1);
+#ifdef __linux__
+    else if(context->type == EVDSPTC_TYPE_REACTOR) evdsptc_reactor_wakeup(context);
+#endif
+    else pthread_cond_broadcast(&context->cv);
+}
+
+static evdsptc_error_t evdsptc_post_lockfree (evdsptc_context_t* context, evdsptc_event_t* event) 
+{
+    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
+
+    __sync_fetch_and_add(&context->mpsc_producers, 1);
+    if(context->state == EVDSPTC_STATUS_RUNNING){
+        event->context = context;
+        evdsptc_event_queued(context, event);
+        evdsptc_mpsc_push(context, &event->listelem);
+        evdsptc_mpsc_wakeup(context);
+    } else ret = EVDSPTC_ERROR_INVALID;
+    __sync_fetch_and_sub(&context->mpsc_producers, 1);
+
+    if(ret != EVDSPTC_ERROR_NONE){
+        evdsptc_event_uncount(context, event);
+        evdsptc_event_drop(context, event);
+    }
+
+    return ret;
+}
+
+static evdsptc_error_t evdsptc_post_local (evdsptc_worker_t* worker, evdsptc_event_t* event) 
+{
+    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
+    evdsptc_context_t* context = worker->context;
+
+    pthread_mutex_lock(&worker->mtx);
+    if(context->state == EVDSPTC_STATUS_RUNNING){
+        event->context = context;
+        evdsptc_list_push(&worker->deque, &event->listelem);
+        __atomic_add_fetch(&worker->depth, 1, __ATOMIC_SEQ_CST);
+        evdsptc_event_queued(context, event);
+    } else ret = EVDSPTC_ERROR_INVALID;
+    pthread_mutex_unlock(&worker->mtx);
+
+    if(ret != EVDSPTC_ERROR_NONE){
+        evdsptc_event_uncount(context, event);
+        evdsptc_event_drop(context, event);
+    }
+    else if(__atomic_load_n(&context->idle_num, __ATOMIC_SEQ_CST) > 0){
+        pthread_mutex_lock(&context->mtx);
+        evdsptc_worker_wakeup(context, 1);
+        pthread_mutex_unlock(&context->mtx);
+    }
+
+    return ret;
+}
+
+evdsptc_error_t evdsptc_trypost (evdsptc_context_t* context, evdsptc_event_t* event) 
+{
+    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
+    evdsptc_worker_t* owner;
+    bool wakeup = true;
+    bool counted = evdsptc_queue_iscounted(context, event);
+    int queued;
+
+    if(counted){
+        if(0 > (queued = evdsptc_queue_reserve(context, 1))) return EVDSPTC_ERROR_FULL;
+        evdsptc_queue_notifyhigh(context, queued);
+    }
+    evdsptc_event_rearm(event);
+    event->counted = counted;
+    if(__atomic_load_n(&context->instrumented, __ATOMIC_RELAXED)) clock_gettime(CLOCK_MONOTONIC, &event->queued_time);
+    if(context->type == EVDSPTC_TYPE_LOCKFREE && EVDSPTC_TIMERTYPE_IMMEDIATE == event->timertype && event->priority == 0)
+        return evdsptc_post_lockfree(context, event);
+
+    if(context->type == EVDSPTC_TYPE_WORKSTEALING && EVDSPTC_TIMERTYPE_IMMEDIATE == event->timertype && event->priority == 0 &&
+            evdsptc_current_worker != NULL && evdsptc_current_worker->context == context)
+        return evdsptc_post_local(evdsptc_current_worker, event);
+
+    pthread_mutex_lock(&context->mtx);
+    if(context->state != EVDSPTC_STATUS_RUNNING) ret = EVDSPTC_ERROR_INVALID;
+    else if(EVDSPTC_TIMERTYPE_IMMEDIATE == event->timertype && NULL != (owner = evdsptc_keyed_owner(context, event))){
+        event->context = context;
+        if(EVDSPTC_ERROR_NONE == (ret = evdsptc_keyed_push(context, owner, event))) evdsptc_event_queued(context, event);
+    }
+    else if(EVDSPTC_TIMERTYPE_IMMEDIATE == event->timertype && !evdsptc_edf_reserve(context, 1)) ret = EVDSPTC_ERROR_FAIL_ALLOC_MEMORY;
+    else{
+        event->context = context;
+        if(EVDSPTC_TIMERTYPE_IMMEDIATE == event->timertype) evdsptc_ready_push(context, event);
+        else wakeup = evdsptc_timer_schedule(context, event);
+        if(wakeup) evdsptc_context_wakeup(context);
+        evdsptc_event_queued(context, event);
+    }
+    pthread_mutex_unlock(&context->mtx);
+
+    if(ret != EVDSPTC_ERROR_NONE){
+        evdsptc_event_uncount(context, event);
+        evdsptc_event_drop(context, event);
+    }
+
+    return ret;
+}
+
+evdsptc_error_t evdsptc_post (evdsptc_context_t* context, evdsptc_event_t* event) 
+{
+    evdsptc_error_t ret = evdsptc_trypost(context, event);
+
+    if(ret == EVDSPTC_ERROR_FULL) evdsptc_event_drop(context, event);
+    return ret;
+}
+
+evdsptc_error_t evdsptc_timedpost (evdsptc_context_t* context, evdsptc_event_t* event, struct timespec* timeout) 
+{
+    evdsptc_error_t ret;
+    struct timespec abstime;
+    bool timedout = false;
+
+    if(timeout != NULL){
+        clock_gettime(CLOCK_REALTIME, &abstime);
+        abstime = evdsptc_timespec_add(&abstime, timeout);
+    }
+    while(EVDSPTC_ERROR_FULL == (ret = evdsptc_trypost(context, event)) && !timedout){
+        pthread_mutex_lock(&context->mtx);
+        __atomic_add_fetch(&context->space_waiters, 1, __ATOMIC_SEQ_CST);
+        if(context->state == EVDSPTC_STATUS_RUNNING &&
+                __atomic_load_n(&context->capacity, __ATOMIC_RELAXED) <= __atomic_load_n(&context->queued_num, __ATOMIC_SEQ_CST)){
+            if(timeout == NULL) pthread_cond_wait(&context->space_cv, &context->mtx);
+            else timedout = (ETIMEDOUT == pthread_cond_timedwait(&context->space_cv, &context->mtx, &abstime));
+        }
+        __atomic_sub_fetch(&context->space_waiters, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&context->mtx);
+    }
+
+    return ret;
+}
+
+static evdsptc_error_t evdsptc_post_lockfreelist (evdsptc_context_t* context, evdsptc_list_t* list) 
+{
+    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
+    evdsptc_listelem_t* first = NULL;
+    evdsptc_listelem_t* last = NULL;
+    evdsptc_listelem_t* listelem;
+
+    __sync_fetch_and_add(&context->mpsc_producers, 1);
+    if(context->state == EVDSPTC_STATUS_RUNNING){
+        while(NULL != (listelem = evdsptc_list_pop(list))){
+            ((evdsptc_event_t*)listelem)->context = context;
+            evdsptc_event_queued(context, (evdsptc_event_t*)listelem);
+            if(last != NULL) last->next = listelem;
+            else first = listelem;
+            last = listelem;
+        }
+        evdsptc_mpsc_pushchain(context, first, last);
+        evdsptc_mpsc_wakeup(context);
+    } else ret = EVDSPTC_ERROR_INVALID;
+    __sync_fetch_and_sub(&context->mpsc_producers, 1);
+
+    return ret;
+}
+
+static evdsptc_error_t evdsptc_post_locallist (evdsptc_worker_t* worker, evdsptc_list_t* list, int n) 
+{
+    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
+    evdsptc_context_t* context = worker->context;
+    evdsptc_listelem_t* listelem;
+
+    pthread_mutex_lock(&worker->mtx);
+    if(context->state == EVDSPTC_STATUS_RUNNING){
+        while(NULL != (listelem = evdsptc_list_pop(list))){
+            ((evdsptc_event_t*)listelem)->context = context;
+            evdsptc_list_push(&worker->deque, listelem);
+            evdsptc_event_queued(context, (evdsptc_event_t*)listelem);
+        }
+        __atomic_add_fetch(&worker->depth, n, __ATOMIC_SEQ_CST);
+    } else ret = EVDSPTC_ERROR_INVALID;
+    pthread_mutex_unlock(&worker->mtx);
+
+    if(ret == EVDSPTC_ERROR_NONE && __atomic_load_n(&context->idle_num, __ATOMIC_SEQ_CST) > 0){
+        pthread_mutex_lock(&context->mtx);
+        evdsptc_worker_wakeup(context, n);
+        pthread_mutex_unlock(&context->mtx);
+    }
+
+    return ret;
+}
+
+evdsptc_error_t evdsptc_post_list (evdsptc_context_t* context, evdsptc_list_t* list) 
+{
+    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
+    evdsptc_list_t unlocked;
+    evdsptc_list_t immediates;
+    evdsptc_list_t timers;
+    evdsptc_list_t failed;
+    evdsptc_listelem_t* listelem;
+    evdsptc_event_t* event;
+    evdsptc_worker_t* owner;
+    struct timespec now;
+    struct timespec monotonic;
+    struct timespec previous;
+    struct timespec* nearest;
+    bool local = (context->type == EVDSPTC_TYPE_WORKSTEALING &&
+            evdsptc_current_worker != NULL && evdsptc_current_worker->context == context);
+    int unlocked_num = 0;
+    int immediates_num = 0;
+    int timers_num = 0;
+    int counted_num = 0;
+    int queued;
+    bool wakeup = false;
+    bool instrumented = __atomic_load_n(&context->instrumented, __ATOMIC_RELAXED);
+
+    evdsptc_list_init(&unlocked);
+    evdsptc_list_init(&immediates);
+    evdsptc_list_init(&timers);
+    evdsptc_list_init(&failed);
+    listelem = evdsptc_list_iterator(list);
+    while(evdsptc_listelem_hasnext(listelem)){
+        listelem = evdsptc_listelem_next(listelem);
+        if(evdsptc_queue_iscounted(context, (evdsptc_event_t*)listelem)) counted_num++;
+    }
+    if(counted_num > 0){
+        if(0 > (queued = evdsptc_queue_reserve(context, counted_num))){
+            evdsptc_list_drop(context, list);
+            return EVDSPTC_ERROR_FULL;
+        }
+        evdsptc_queue_notifyhigh(context, queued);
+    }
+
+    if(instrumented) clock_gettime(CLOCK_MONOTONIC, &now);
+    while(NULL != (listelem = evdsptc_list_pop(list))){
+        event = (evdsptc_event_t*)listelem;
+        evdsptc_event_rearm(event);
+        event->counted = (counted_num > 0 && EVDSPTC_TIMERTYPE_IMMEDIATE == event->timertype && event->handler != evdsptc_strand_run);
+        if(instrumented) event->queued_time = now;
+        if(EVDSPTC_TIMERTYPE_IMMEDIATE != event->timertype){
+            evdsptc_list_push(&timers, listelem);
+            timers_num++;
+        }else if(event->priority == 0 && (context->type == EVDSPTC_TYPE_LOCKFREE || local)){
+            evdsptc_list_push(&unlocked, listelem);
+            unlocked_num++;
+        }else{
+            evdsptc_list_push(&immediates, listelem);
+            immediates_num++;
+        }
+    }
+
+    if(unlocked_num > 0 && context->type == EVDSPTC_TYPE_LOCKFREE) ret = evdsptc_post_lockfreelist(context, &unlocked);
+    else if(unlocked_num > 0) ret = evdsptc_post_locallist(evdsptc_current_worker, &unlocked, unlocked_num);
+
+    if(ret == EVDSPTC_ERROR_NONE && immediates_num + timers_num > 0){
+        pthread_mutex_lock(&context->mtx);
+        if(context->state != EVDSPTC_STATUS_RUNNING) ret = EVDSPTC_ERROR_INVALID;
+        else if(!evdsptc_edf_reserve(context, immediates_num)) ret = EVDSPTC_ERROR_FAIL_ALLOC_MEMORY;
+        else{
+            while(NULL != (event = (evdsptc_event_t*)evdsptc_list_pop(&immediates))){
+                event->context = context;
+                if(NULL == (owner = evdsptc_keyed_owner(context, event))) evdsptc_ready_push(context, event);
+                else{
+                    immediates_num--;
+                    if(EVDSPTC_ERROR_NONE != evdsptc_keyed_push(context, owner, event)){
+                        evdsptc_list_push(&failed, &event->listelem);
+                        continue;
+                    }
+                }
+                evdsptc_event_queued(context, event);
+            }
+            if(timers_num > 0){
+                clock_gettime(CLOCK_REALTIME, &now);
+                clock_gettime(CLOCK_MONOTONIC, &monotonic);
+                listelem = evdsptc_list_iterator(&timers);
+                while(evdsptc_listelem_hasnext(listelem)){
+                    listelem = evdsptc_listelem_next(listelem);
+                    event = (evdsptc_event_t*)listelem;
+                    event->context = context;
+                    if(EVDSPTC_TIMERTYPE_RELATIVE == event->timertype){
+                        event->timer = evdsptc_timespec_add(evdsptc_timer_clock(context, event) == CLOCK_MONOTONIC ? &monotonic : &now, &event->timer);
+                    }
+                    evdsptc_event_queued(context, event);
+                }
+                // the timer thread of the timerfd backend is woken up by the insertion instead of a worker.
+                if(context->timer_backend == EVDSPTC_TIMERBACKEND_TIMERFD){
+                    evdsptc_timer_insertlist(context, &timers, timers_num);
+                }else{
+                    nearest = evdsptc_timer_nearest(context);
+                    wakeup = (nearest == NULL);
+                    if(!wakeup) previous = *nearest;
+                    evdsptc_timer_insertlist(context, &timers, timers_num);
+                    if(!wakeup) wakeup = (evdsptc_timespec_compare(evdsptc_timer_nearest(context), &previous) < 0);
+                }
+            }
+            if(context->type == EVDSPTC_TYPE_NORMAL) evdsptc_pool_wakeup(context, immediates_num + (wakeup ? 1 : 0));
+            else if(context->type == EVDSPTC_TYPE_WORKSTEALING) evdsptc_worker_wakeup(context, immediates_num + (wakeup ? 1 : 0));
+            else if(immediates_num > 0 || wakeup) evdsptc_context_wakeup(context);
+        }
+        pthread_mutex_unlock(&context->mtx);
+    }
+
+    if(ret != EVDSPTC_ERROR_NONE){
+        evdsptc_list_drop(context, &unlocked);
+        evdsptc_list_drop(context, &immediates);
+        evdsptc_list_drop(context, &timers);
+    }
+    if(!evdsptc_list_isempty(&failed)){
+        ret = EVDSPTC_ERROR_FAIL_CREATE_THREAD;
+        evdsptc_list_drop(context, &failed);
+    }
+
+    return ret;
+}
+
+evdsptc_error_t evdsptc_post_coalesce (evdsptc_context_t* context, evdsptc_event_t* event, unsigned long long int coalesce_key) 
+{
+    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
+    evdsptc_event_t** slot;
+    evdsptc_event_t* replaced = NULL;
+    evdsptc_worker_t* owner;
+    bool instrumented = __atomic_load_n(&context->instrumented, __ATOMIC_RELAXED);
+    struct timespec now;
+    int queued = -1;
+
+    if(EVDSPTC_TIMERTYPE_IMMEDIATE != event->timertype || context->type == EVDSPTC_TYPE_PERIODIC){
+        evdsptc_event_drop(context, event);
+        return EVDSPTC_ERROR_INVALID;
+    }
+    if(instrumented) clock_gettime(CLOCK_MONOTONIC, &now);
+
+    pthread_mutex_lock(&context->mtx);
+    // the event still pending under its key is left as it is, since it would replace itself.
+    if(context->state == EVDSPTC_STATUS_RUNNING && event->coalescing && event->context == context){
+        ret = (event->coalesce_key == coalesce_key) ? EVDSPTC_ERROR_NONE : EVDSPTC_ERROR_INVALID;
+        pthread_mutex_unlock(&context->mtx);
+        return ret;
+    }
+    evdsptc_event_rearm(event);
+    if(instrumented) event->queued_time = now;
+    event->coalesce_key = coalesce_key;
+    event->counted = false;
+    if(context->state != EVDSPTC_STATUS_RUNNING) ret = EVDSPTC_ERROR_INVALID;
+    else if(NULL != (slot = evdsptc_coalesce_find(context, coalesce_key))){
+        replaced = *slot;
+        event->context = context;
+        evdsptc_coalesce_replace(context, slot, event);
+        evdsptc_event_queued(context, event);
+    }
+    else if(!evdsptc_coalesce_reserve(context) || !evdsptc_edf_reserve(context, 1)) ret = EVDSPTC_ERROR_FAIL_ALLOC_MEMORY;
+    else if(evdsptc_queue_iscounted(context, event) && 0 > (queued = evdsptc_queue_reserve(context, 1))) ret = EVDSPTC_ERROR_FULL;
+    else{
+        event->context = context;
+        event->counted = (0 <= queued);
+        if(NULL != (owner = evdsptc_keyed_owner(context, event))) ret = evdsptc_keyed_push(context, owner, event);
+        else{
+            evdsptc_ready_push(context, event);
+            evdsptc_context_wakeup(context);
+        }
+        if(ret == EVDSPTC_ERROR_NONE){
+            evdsptc_coalesce_insert(context, event);
+            evdsptc_event_queued(context, event);
+        }
+    }
+    pthread_mutex_unlock(&context->mtx);
+
+    if(replaced != NULL){
+        EVDSPTC_TRACE("replacing event %p with %p ...", replaced, event); 
+        evdsptc_event_drop(context, replaced);
+    }
+    if(ret != EVDSPTC_ERROR_NONE){
+        evdsptc_event_uncount(context, event);
+        evdsptc_event_drop(context, event);
+    }
+    else if(0 <= queued) evdsptc_queue_notifyhigh(context, queued);
+
+    return ret;
+}
+
+evdsptc_error_t evdsptc_post_batch (evdsptc_context_t* context, evdsptc_event_t** events, int n) 
+{
+    evdsptc_list_t list;
+    int i;
+
+    evdsptc_list_init(&list);
+    for(i = 0; i < n; i++) evdsptc_list_push(&list, &events[i]->listelem);
+
+    return evdsptc_post_list(context, &list);
+}
+
+evdsptc_error_t evdsptc_timer_cancel (evdsptc_context_t* context, evdsptc_event_t* event) 
+{
+    evdsptc_error_t ret = EVDSPTC_ERROR_INVALID;
+
+    pthread_mutex_lock(&context->mtx);
+    if(context->state == EVDSPTC_STATUS_RUNNING && evdsptc_timer_remove(context, event)) ret = EVDSPTC_ERROR_NONE;
+    pthread_mutex_unlock(&context->mtx);
+
+    if(ret == EVDSPTC_ERROR_NONE) evdsptc_event_drop(context, event);
+
+    return ret;
+}
+
+evdsptc_error_t evdsptc_event_reschedule (evdsptc_context_t* context, evdsptc_event_t* event, struct timespec* timer, evdsptc_timertype_t type) 
+{
+    evdsptc_error_t ret = EVDSPTC_ERROR_INVALID;
+
+    if(EVDSPTC_TIMERTYPE_IMMEDIATE == type) return ret;
+
+    pthread_mutex_lock(&context->mtx);
+    if(context->state == EVDSPTC_STATUS_RUNNING && evdsptc_timer_remove(context, event)){
+        evdsptc_event_settimer(event, timer, type);
+        if(evdsptc_timer_schedule(context, event)) evdsptc_context_wakeup(context);
+        ret = EVDSPTC_ERROR_NONE;
+    }
+    pthread_mutex_unlock(&context->mtx);
+
+    return ret;
+}
+
+evdsptc_error_t evdsptc_event_waitdone (evdsptc_event_t* event) 
+{
+    evdsptc_error_t ret = evdsptc_event_wait(event, true);
+    __sync_synchronize();
+    
+    if(ret == EVDSPTC_ERROR_NONE && event->is_canceled == true) ret = EVDSPTC_ERROR_CANCELED;
+
+    return ret;
+}
+
+evdsptc_error_t evdsptc_event_trywaitdone (evdsptc_event_t* event) 
+{
+    evdsptc_error_t ret = evdsptc_event_wait(event, false);
+    __sync_synchronize();
+    
+    if(ret == EVDSPTC_ERROR_NONE && event->is_canceled == true) ret = EVDSPTC_ERROR_CANCELED;
+
+    return ret;
+}
+
+evdsptc_error_t evdsptc_event_init (evdsptc_event_t* event, 
+        evdsptc_handler_t event_handler,
+        void* event_param,
+        bool auto_destruct,
+        evdsptc_event_destructor_t destructor)
+{
+    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
+
+    event->handler = event_handler;
+    event->batch_handler = NULL;
+    event->param = event_param;
+    event->is_canceled = false;
+    event->is_done = false;
+#ifdef __linux__
+    event->completion = EVDSPTC_COMPLETION_PENDING;
+#else
+    sem_init(&event->sem, 0, 0);
+#endif
+    event->listelem.root = NULL;
+    event->listelem.prev = NULL;
+    event->listelem.next = NULL;
+    event->listelem.destructor = evdsptc_listelem_cancel;
+    event->destructor = destructor;
+    event->auto_destruct = auto_destruct;
+    event->timer.tv_sec = 0;
+    event->timer.tv_nsec = 0;
+    event->timertype = EVDSPTC_TIMERTYPE_IMMEDIATE;
+    event->priority = 0;
+    event->queued_time.tv_sec = 0;
+    event->queued_time.tv_nsec = 0;
+    event->deadline.tv_sec = 0;
+    event->deadline.tv_nsec = 0;
+    event->deadlinetype = EVDSPTC_TIMERTYPE_IMMEDIATE;
+    event->sequence = 0;
+    event->rate_divisor = 1;
+    event->rate_phase = 0;
+    event->next_period = 0;
+    event->keyed = false;
+    event->key = 0;
+    event->coalescing = false;
+    event->coalesce_key = 0;
+    event->coalesce_next = NULL;
+    event->heap_index = 0;
+    event->counted = false;
+
+    return ret;
+}
+
+void evdsptc_event_settimer (evdsptc_event_t* event, struct timespec* timer, evdsptc_timertype_t type)
+{
+    event->timer = *timer;
+    event->timertype = type;
+}
+
+void* evdsptc_event_getparam(evdsptc_event_t* event){
+    return event->param; 
+}
+
+void evdsptc_event_free (evdsptc_event_t* event){
+    free(event);
+}
+
+pthread_t* evdsptc_getthreads(evdsptc_context_t* context){
+    return context->th;
+}
+
+int evdsptc_getthreadsnum(evdsptc_context_t* context){
+    int threads_num;
+
+    pthread_mutex_lock(&context->mtx);
+    threads_num = context->threads_num;
+    pthread_mutex_unlock(&context->mtx);
+    return threads_num;
+}
+
+pthread_mutex_t* evdsptc_getmutex(evdsptc_context_t* context){
+    return &context->mtx;
+}
+
+void evdsptc_setmutexattrinitializer(pthread_mutexattr_t* attr){
+    evdsptc_mutexattrinitializer = *attr;
+    evdsptc_pmutexattrinitializer = &evdsptc_mutexattrinitializer;
+}
+
+void evdsptc_event_makedone (evdsptc_event_t* event){
+    event->is_done = true;
+    __sync_synchronize();
+    evdsptc_event_complete(event);
 }
 
 bool evdsptc_event_isdone (evdsptc_event_t* event){
@@ -503,3 +2788,772 @@ void evdsptc_event_setdestructor (evdsptc_event_t* event, evdsptc_event_destruct
 void evdsptc_event_setautodestruct (evdsptc_event_t* event, bool auto_destruct){
     event->auto_destruct = auto_destruct;
 }
+
+void evdsptc_event_setpriority (evdsptc_event_t* event, int priority){
+    if(priority < 0) priority = 0;
+    if(EVDSPTC_PRIORITY_LEVELS <= priority) priority = EVDSPTC_PRIORITY_LEVELS - 1;
+    event->priority = priority;
+}
+
+evdsptc_error_t evdsptc_setcapacity (evdsptc_context_t* context, int capacity){
+    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
+
+    if(capacity < 0) return EVDSPTC_ERROR_INVALID;
+    pthread_mutex_lock(&context->mtx);
+    if(context->state != EVDSPTC_STATUS_RUNNING || context->type == EVDSPTC_TYPE_PERIODIC) ret = EVDSPTC_ERROR_INVALID;
+    else{
+        __atomic_store_n(&context->capacity, capacity, __ATOMIC_RELAXED);
+        __atomic_store_n(&context->bounded, (0 < capacity || 0 < context->high_watermark), __ATOMIC_RELAXED);
+        pthread_cond_broadcast(&context->space_cv);
+    }
+    pthread_mutex_unlock(&context->mtx);
+
+    return ret;
+}
+
+evdsptc_error_t evdsptc_setwatermarks (evdsptc_context_t* context, int high_watermark, int low_watermark,
+        evdsptc_watermark_callback_t high_callback, evdsptc_watermark_callback_t low_callback){
+    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
+
+    if(high_watermark < 0 || low_watermark < 0 || (0 < high_watermark && high_watermark <= low_watermark)) return EVDSPTC_ERROR_INVALID;
+    pthread_mutex_lock(&context->mtx);
+    if(context->state != EVDSPTC_STATUS_RUNNING || context->type == EVDSPTC_TYPE_PERIODIC) ret = EVDSPTC_ERROR_INVALID;
+    else{
+        context->high_watermark = high_watermark;
+        context->low_watermark = low_watermark;
+        context->high_callback = high_callback;
+        context->low_callback = low_callback;
+        context->congested = false;
+        __atomic_store_n(&context->bounded, (0 < context->capacity || 0 < high_watermark), __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&context->mtx);
+
+    return ret;
+}
+
+int evdsptc_getqueuednum (evdsptc_context_t* context){
+    return __atomic_load_n(&context->queued_num, __ATOMIC_SEQ_CST);
+}
+
+void evdsptc_event_setkey (evdsptc_event_t* event, unsigned long long int key){
+    event->key = key;
+    event->keyed = true;
+}
+
+evdsptc_error_t evdsptc_setpriorityaging (evdsptc_context_t* context, struct timespec* aging){
+    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
+
+    if(aging != NULL && (aging->tv_sec < 0 || aging->tv_nsec < 0)) return EVDSPTC_ERROR_INVALID;
+
+    pthread_mutex_lock(&context->mtx);
+    if(context->state != EVDSPTC_STATUS_RUNNING) ret = EVDSPTC_ERROR_INVALID;
+    else if(aging == NULL){
+        context->priority_aging.tv_sec = 0;
+        context->priority_aging.tv_nsec = 0;
+    }else context->priority_aging = *aging;
+    pthread_mutex_unlock(&context->mtx);
+
+    return ret;
+}
+
+void evdsptc_event_setdeadline (evdsptc_event_t* event, struct timespec* deadline, evdsptc_timertype_t type){
+    event->deadline = *deadline;
+    event->deadlinetype = type;
+}
+
+evdsptc_error_t evdsptc_event_setrate (evdsptc_event_t* event, unsigned int divisor, unsigned int phase){
+    if(divisor == 0 || divisor <= phase) return EVDSPTC_ERROR_INVALID;
+    event->rate_divisor = divisor;
+    event->rate_phase = phase;
+    return EVDSPTC_ERROR_NONE;
+}
+
+unsigned long long int evdsptc_getperiodcount (evdsptc_context_t* context){
+    return __atomic_load_n(&context->period_count, __ATOMIC_RELAXED);
+}
+
+bool evdsptc_isperiodoverrun (evdsptc_context_t* context){
+    return __atomic_load_n(&context->period_overrun, __ATOMIC_RELAXED);
+}
+
+evdsptc_error_t evdsptc_setoverrunpolicy (evdsptc_context_t* context, evdsptc_overrunpolicy_t policy){
+    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
+
+    if(policy != EVDSPTC_OVERRUNPOLICY_SHIFT && policy != EVDSPTC_OVERRUNPOLICY_SKIP && policy != EVDSPTC_OVERRUNPOLICY_CATCHUP) return EVDSPTC_ERROR_INVALID;
+
+    pthread_mutex_lock(&context->mtx);
+    if(context->state != EVDSPTC_STATUS_RUNNING || context->type != EVDSPTC_TYPE_PERIODIC) ret = EVDSPTC_ERROR_INVALID;
+    else context->overrun_policy = policy;
+    pthread_mutex_unlock(&context->mtx);
+
+    return ret;
+}
+
+evdsptc_error_t evdsptc_getperiodstats (evdsptc_context_t* context, evdsptc_periodstats_t* stats, bool reset){
+    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
+
+    if(context->type != EVDSPTC_TYPE_PERIODIC) return EVDSPTC_ERROR_INVALID;
+
+    pthread_mutex_lock(&context->mtx);
+    if(context->period_stats == NULL) ret = EVDSPTC_ERROR_INVALID;
+    else{
+        *stats = *context->period_stats;
+        if(reset) memset(context->period_stats, 0, sizeof(evdsptc_periodstats_t));
+    }
+    pthread_mutex_unlock(&context->mtx);
+
+    return ret;
+}
+
+evdsptc_error_t evdsptc_setinstrumentation (evdsptc_context_t* context, bool enable){
+    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
+    int i;
+
+    pthread_mutex_lock(&context->mtx);
+    if(context->state != EVDSPTC_STATUS_RUNNING) ret = EVDSPTC_ERROR_INVALID;
+    else if(enable && context->event_stats == NULL){
+        context->event_stats = (evdsptc_eventstats_t*)calloc(evdsptc_slots_num(context), sizeof(evdsptc_eventstats_t));
+        if(context->event_stats == NULL) ret = EVDSPTC_ERROR_FAIL_ALLOC_MEMORY;
+        for(i = 0; ret == EVDSPTC_ERROR_NONE && i < evdsptc_slots_num(context); i++){
+            context->event_stats[i].wait.min = LLONG_MAX;
+            context->event_stats[i].service.min = LLONG_MAX;
+        }
+    }
+    // the statistics are kept until destroy, since workers may still be recording to them.
+    if(ret == EVDSPTC_ERROR_NONE) __atomic_store_n(&context->instrumented, enable, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&context->mtx);
+
+    return ret;
+}
+
+evdsptc_error_t evdsptc_geteventstats (evdsptc_context_t* context, evdsptc_eventstats_t* stats, bool reset){
+    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
+    int i;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->wait.min = LLONG_MAX;
+    stats->service.min = LLONG_MAX;
+
+    pthread_mutex_lock(&context->mtx);
+    if(context->event_stats == NULL) ret = EVDSPTC_ERROR_INVALID;
+    for(i = 0; ret == EVDSPTC_ERROR_NONE && i < evdsptc_slots_num(context); i++){
+        evdsptc_histogram_merge(&stats->wait, &context->event_stats[i].wait, reset);
+        evdsptc_histogram_merge(&stats->service, &context->event_stats[i].service, reset);
+    }
+    pthread_mutex_unlock(&context->mtx);
+
+    if(stats->wait.count == 0) stats->wait.min = 0;
+    if(stats->service.count == 0) stats->service.min = 0;
+    return ret;
+}
+
+long long int evdsptc_histogram_percentile (evdsptc_histogram_t* histogram, double percentile){
+    unsigned long long int rank;
+    unsigned long long int seen = 0;
+    long long int value;
+    int i;
+
+    if(histogram->count == 0) return 0;
+    if(percentile <= 0.0) return histogram->min;
+    if(100.0 <= percentile) return histogram->max;
+    rank = (unsigned long long int)(percentile * histogram->count / 100.0);
+    if(rank < percentile * histogram->count / 100.0) rank++;
+    if(rank == 0) rank = 1;
+    for(i = 0; i < EVDSPTC_HISTOGRAM_BUCKETS; i++){
+        seen += histogram->buckets[i];
+        if(rank <= seen) break;
+    }
+    value = evdsptc_histogram_bucketmax(i);
+    if(histogram->max < value) value = histogram->max;
+    if(value < histogram->min) value = histogram->min;
+    return value;
+}
+
+evdsptc_error_t evdsptc_setschedpolicy (evdsptc_context_t* context, evdsptc_schedpolicy_t policy, bool drop_missed){
+    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
+    evdsptc_list_t pending;
+    evdsptc_event_t* event;
+    int pending_num = 0;
+
+    if(policy != EVDSPTC_SCHEDPOLICY_PRIORITY && policy != EVDSPTC_SCHEDPOLICY_EDF) return EVDSPTC_ERROR_INVALID;
+
+    pthread_mutex_lock(&context->mtx);
+    if(context->state != EVDSPTC_STATUS_RUNNING || context->type != EVDSPTC_TYPE_NORMAL) ret = EVDSPTC_ERROR_INVALID;
+    else if(policy != context->sched_policy){
+        evdsptc_list_init(&pending);
+        while(NULL != (event = evdsptc_ready_pop(context))){
+            evdsptc_list_push(&pending, &event->listelem);
+            pending_num++;
+        }
+        context->sched_policy = policy;
+        if(!evdsptc_edf_reserve(context, pending_num)){
+            context->sched_policy = EVDSPTC_SCHEDPOLICY_PRIORITY;
+            ret = EVDSPTC_ERROR_FAIL_ALLOC_MEMORY;
+        }
+        while(NULL != (event = (evdsptc_event_t*)evdsptc_list_pop(&pending))) evdsptc_ready_push(context, event);
+    }
+    if(ret == EVDSPTC_ERROR_NONE) context->drop_missed = (policy == EVDSPTC_SCHEDPOLICY_EDF && drop_missed);
+    pthread_mutex_unlock(&context->mtx);
+
+    return ret;
+}
+
+unsigned long long int evdsptc_getdeadlinemisscount (evdsptc_context_t* context){
+    return __atomic_load_n(&context->deadline_miss_count, __ATOMIC_RELAXED);
+}
+
+void evdsptc_event_setbatchhandler (evdsptc_event_t* event, evdsptc_batch_handler_t batch_handler){
+    event->batch_handler = batch_handler;
+}
+
+evdsptc_error_t evdsptc_setbatchsize (evdsptc_context_t* context, int batch_size){
+    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
+
+    if(batch_size < 1 || EVDSPTC_MAX_BATCH_SIZE < batch_size) return EVDSPTC_ERROR_INVALID;
+
+    pthread_mutex_lock(&context->mtx);
+    if(context->state != EVDSPTC_STATUS_RUNNING || 
+            (context->type != EVDSPTC_TYPE_NORMAL && context->type != EVDSPTC_TYPE_LOCKFREE && context->type != EVDSPTC_TYPE_REACTOR)) ret = EVDSPTC_ERROR_INVALID;
+    else context->batch_size = batch_size;
+    pthread_mutex_unlock(&context->mtx);
+
+    return ret;
+}
+
+#ifdef __linux__
+// arms the timerfd at the first timer event of the list that has not expired yet, or disarms it.
+// returns the number of the expired ones.
+static int evdsptc_timerfd_arm (int fd, evdsptc_list_t* list, clockid_t clock){
+    evdsptc_listelem_t* listelem = evdsptc_list_iterator(list);
+    struct itimerspec spec;
+    struct timespec now;
+    int n = 0;
+
+    memset(&spec, 0, sizeof(spec));
+    clock_gettime(clock, &now);
+    while(evdsptc_listelem_hasnext(listelem)){
+        listelem = evdsptc_listelem_next(listelem);
+        if(evdsptc_timespec_compare(&((evdsptc_event_t*)listelem)->timer, &now) > 0){
+            spec.it_value = ((evdsptc_event_t*)listelem)->timer;
+            break;
+        }
+        n++;
+    }
+    timerfd_settime(fd, TFD_TIMER_ABSTIME, &spec, NULL);
+    return n;
+}
+
+// the only thread that arms the timerfds. the workers sleep without a timeout and are woken up by this thread.
+static void* evdsptc_timer_routine (void* arg){
+    evdsptc_context_t* context = (evdsptc_context_t*)arg;
+    evdsptc_list_t disarmed;
+    struct pollfd fds[3];
+    bool armed;
+    int n;
+    int i;
+
+    evdsptc_list_init(&disarmed);
+    fds[0].fd = context->timer_kickfd;
+    fds[1].fd = context->timer_monofd;
+    fds[2].fd = context->timer_realfd;
+    for(i = 0; i < 3; i++) fds[i].events = POLLIN;
+
+    pthread_mutex_lock(&context->mtx);
+    while(context->state == EVDSPTC_STATUS_RUNNING){
+        // the timer list belongs to the other backends while they are selected.
+        armed = (context->timer_backend == EVDSPTC_TIMERBACKEND_TIMERFD);
+        n = evdsptc_timerfd_arm(context->timer_monofd, armed ? &context->timer_monolist : &disarmed, CLOCK_MONOTONIC);
+        n += evdsptc_timerfd_arm(context->timer_realfd, armed ? &context->timer_list : &disarmed, CLOCK_REALTIME);
+        if(n > 0){
+            if(context->type == EVDSPTC_TYPE_NORMAL) evdsptc_pool_wakeup(context, n);
+            else if(context->type == EVDSPTC_TYPE_WORKSTEALING) evdsptc_worker_wakeup(context, n);
+            else evdsptc_context_wakeup(context);
+        }
+        pthread_mutex_unlock(&context->mtx);
+
+        while(-1 == poll(fds, 3, -1) && errno == EINTR) continue;
+        for(i = 0; i < 3; i++){
+            if(fds[i].revents & POLLIN) evdsptc_eventfd_clear(fds[i].fd);
+        }
+        pthread_mutex_lock(&context->mtx);
+    }
+    pthread_mutex_unlock(&context->mtx);
+    return NULL;
+}
+
+// creates the timerfds and starts the timer thread. context->mtx must be locked.
+static evdsptc_error_t evdsptc_timer_start (evdsptc_context_t* context){
+    context->timer_monofd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    context->timer_realfd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+    context->timer_kickfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(context->timer_monofd < 0 || context->timer_realfd < 0 || context->timer_kickfd < 0) return EVDSPTC_ERROR_FAIL_INIT_IO;
+    if(0 != pthread_create(&context->timer_thread, NULL, evdsptc_timer_routine, context)) return EVDSPTC_ERROR_FAIL_CREATE_THREAD;
+    context->timer_threaded = true;
+    return EVDSPTC_ERROR_NONE;
+}
+#endif
+
+evdsptc_error_t evdsptc_settimerbackend (evdsptc_context_t* context, evdsptc_timerbackend_t backend, struct timespec* resolution){
+    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
+    evdsptc_timerwheel_t* wheel = NULL;
+    evdsptc_list_t pending;
+    evdsptc_listelem_t* listelem;
+    evdsptc_event_t* event;
+    struct timespec realtime[2];
+    struct timespec monotonic;
+    int level;
+    int index;
+
+    if(backend == EVDSPTC_TIMERBACKEND_WHEEL){
+        if(resolution == NULL || resolution->tv_sec < 0 || resolution->tv_nsec < 0 ||
+                (resolution->tv_sec == 0 && resolution->tv_nsec == 0)) return EVDSPTC_ERROR_INVALID;
+        wheel = (evdsptc_timerwheel_t*)malloc(sizeof(evdsptc_timerwheel_t));
+        if(wheel == NULL) return EVDSPTC_ERROR_FAIL_ALLOC_MEMORY;
+        wheel->resolution_ns = resolution->tv_sec * 1000LL * 1000LL * 1000LL + resolution->tv_nsec;
+        clock_gettime(CLOCK_REALTIME, &wheel->origin);
+        wheel->base = 0;
+        for(level = 0; level < EVDSPTC_WHEEL_LEVELS; level++){
+            wheel->bitmap[level] = 0;
+            for(index = 0; index < EVDSPTC_WHEEL_SLOTS; index++) evdsptc_list_init(&wheel->slots[level][index]);
+        }
+        evdsptc_list_init(&wheel->overflow);
+        evdsptc_list_init(&wheel->expired);
+#ifdef __linux__
+    }else if(backend != EVDSPTC_TIMERBACKEND_LIST && backend != EVDSPTC_TIMERBACKEND_TIMERFD) return EVDSPTC_ERROR_INVALID;
+#else
+    }else if(backend != EVDSPTC_TIMERBACKEND_LIST) return EVDSPTC_ERROR_INVALID;
+#endif
+
+    pthread_mutex_lock(&context->mtx);
+    if(context->state != EVDSPTC_STATUS_RUNNING || context->type == EVDSPTC_TYPE_PERIODIC){
+        ret = EVDSPTC_ERROR_INVALID;
+        free(wheel);
+    }
+#ifdef __linux__
+    // the timer thread is started once and kept, even if another backend is selected later.
+    else if(backend == EVDSPTC_TIMERBACKEND_TIMERFD && !context->timer_threaded &&
+            EVDSPTC_ERROR_NONE != (ret = evdsptc_timer_start(context))){
+        if(0 <= context->timer_monofd) close(context->timer_monofd);
+        if(0 <= context->timer_realfd) close(context->timer_realfd);
+        if(0 <= context->timer_kickfd) close(context->timer_kickfd);
+        context->timer_monofd = -1;
+        context->timer_realfd = -1;
+        context->timer_kickfd = -1;
+    }
+#endif
+    else{
+        evdsptc_list_init(&pending);
+        evdsptc_timer_takeall(context, &pending);
+        free(context->timer_wheel);
+        // the clock read later is the target of the rebase, so that the timers never move earlier.
+        clock_gettime(CLOCK_REALTIME, &realtime[0]);
+        clock_gettime(CLOCK_MONOTONIC, &monotonic);
+        clock_gettime(CLOCK_REALTIME, &realtime[1]);
+        listelem = evdsptc_list_iterator(&pending);
+        while(evdsptc_listelem_hasnext(listelem)){
+            listelem = evdsptc_listelem_next(listelem);
+            event = (evdsptc_event_t*)listelem;
+            if(evdsptc_timer_clock(context, event) == CLOCK_MONOTONIC) evdsptc_timer_rebase(event, &monotonic, &realtime[1]);
+        }
+        context->timer_backend = backend;
+        context->timer_wheel = wheel;
+        context->timer_num = 0;
+        while(NULL != (event = (evdsptc_event_t*)evdsptc_list_pop(&pending))){
+            if(evdsptc_timer_clock(context, event) == CLOCK_MONOTONIC) evdsptc_timer_rebase(event, &realtime[0], &monotonic);
+            evdsptc_timer_insert(context, event);
+        }
+        pthread_cond_broadcast(&context->cv);
+        evdsptc_worker_wakeup(context, context->threads_num);
+        evdsptc_timer_kick(context);
+    }
+    pthread_mutex_unlock(&context->mtx);
+
+    return ret;
+}
+
+evdsptc_error_t evdsptc_eventpool_create (evdsptc_eventpool_t* pool, int capacity){
+    evdsptc_eventpool_elem_t* elems;
+    int i;
+
+    if(capacity < 1) return EVDSPTC_ERROR_INVALID;
+    elems = (evdsptc_eventpool_elem_t*)calloc(capacity, sizeof(evdsptc_eventpool_elem_t));
+    if(elems == NULL) return EVDSPTC_ERROR_FAIL_ALLOC_MEMORY;
+
+    for(i = 0; i < EVDSPTC_EVENTPOOL_SHARDS; i++){
+        if(0 != pthread_mutex_init(&pool->shards[i].mtx, evdsptc_pmutexattrinitializer)){
+            while(i-- > 0) pthread_mutex_destroy(&pool->shards[i].mtx);
+            free(elems);
+            return EVDSPTC_ERROR_FAIL_INIT_MUTEX;
+        }
+        evdsptc_list_init(&pool->shards[i].list);
+        pool->shards[i].outstanding = 0;
+    }
+    for(i = 0; i < capacity; i++){
+        elems[i].pool = pool;
+        evdsptc_list_push(&pool->shards[i % EVDSPTC_EVENTPOOL_SHARDS].list, &elems[i].event.listelem);
+    }
+    pool->storage = elems;
+    pool->capacity = capacity;
+    pool->exhausted_count = 0;
+
+    return EVDSPTC_ERROR_NONE;
+}
+
+evdsptc_error_t evdsptc_eventpool_destroy (evdsptc_eventpool_t* pool){
+    int outstanding = 0;
+    int i;
+
+    for(i = 0; i < EVDSPTC_EVENTPOOL_SHARDS; i++) pthread_mutex_lock(&pool->shards[i].mtx);
+    for(i = 0; i < EVDSPTC_EVENTPOOL_SHARDS; i++) outstanding += pool->shards[i].outstanding;
+    for(i = EVDSPTC_EVENTPOOL_SHARDS - 1; 0 <= i; i--) pthread_mutex_unlock(&pool->shards[i].mtx);
+    if(outstanding != 0) return EVDSPTC_ERROR_NOT_DONE;
+
+    for(i = 0; i < EVDSPTC_EVENTPOOL_SHARDS; i++){
+        evdsptc_list_init(&pool->shards[i].list);
+        pthread_mutex_destroy(&pool->shards[i].mtx);
+    }
+    free(pool->storage);
+    pool->storage = NULL;
+    pool->capacity = 0;
+    return EVDSPTC_ERROR_NONE;
+}
+
+// each thread returns events to its own shard and refills from the others when it runs dry.
+static evdsptc_eventpool_shard_t* evdsptc_eventpool_getshard (evdsptc_eventpool_t* pool){
+    if(evdsptc_current_shard < 0) evdsptc_current_shard = __sync_fetch_and_add(&evdsptc_shard_next, 1) % EVDSPTC_EVENTPOOL_SHARDS;
+    return &pool->shards[evdsptc_current_shard];
+}
+
+evdsptc_error_t evdsptc_eventpool_alloc (evdsptc_eventpool_t* pool, evdsptc_event_t** event,
+        evdsptc_handler_t event_handler,
+        void* event_param)
+{
+    evdsptc_eventpool_shard_t* own = evdsptc_eventpool_getshard(pool);
+    evdsptc_eventpool_shard_t* other;
+    evdsptc_list_t refill;
+    evdsptc_listelem_t* listelem;
+    int i, n;
+
+    pthread_mutex_lock(&own->mtx);
+    if(NULL != (listelem = evdsptc_list_pop(&own->list))) own->outstanding++;
+    pthread_mutex_unlock(&own->mtx);
+
+    for(i = 1; listelem == NULL && i < EVDSPTC_EVENTPOOL_SHARDS; i++){
+        other = &pool->shards[(evdsptc_current_shard + i) % EVDSPTC_EVENTPOOL_SHARDS];
+        evdsptc_list_init(&refill);
+        pthread_mutex_lock(&other->mtx);
+        listelem = evdsptc_list_pop(&other->list);
+        for(n = 1; listelem != NULL && n < EVDSPTC_EVENTPOOL_REFILL && !evdsptc_list_isempty(&other->list); n++)
+            evdsptc_list_push(&refill, evdsptc_list_pop(&other->list));
+        if(listelem != NULL) other->outstanding += n;
+        pthread_mutex_unlock(&other->mtx);
+
+        if(1 < n){
+            pthread_mutex_lock(&own->mtx);
+            while(!evdsptc_list_isempty(&refill)) evdsptc_list_push(&own->list, evdsptc_list_pop(&refill));
+            own->outstanding -= n - 1;
+            pthread_mutex_unlock(&own->mtx);
+        }
+    }
+
+    if(listelem == NULL){
+        __sync_fetch_and_add(&pool->exhausted_count, 1);
+        *event = NULL;
+        return EVDSPTC_ERROR_POOL_EXHAUSTED;
+    }
+
+    *event = (evdsptc_event_t*)listelem;
+    return evdsptc_event_init(*event, event_handler, event_param, true, evdsptc_eventpool_free);
+}
+
+void evdsptc_eventpool_free (evdsptc_event_t* event){
+    evdsptc_eventpool_t* pool = ((evdsptc_eventpool_elem_t*)event)->pool;
+    evdsptc_eventpool_shard_t* own = evdsptc_eventpool_getshard(pool);
+
+    pthread_mutex_lock(&own->mtx);
+    evdsptc_list_push(&own->list, &event->listelem);
+    own->outstanding--;
+    pthread_mutex_unlock(&own->mtx);
+}
+
+static bool evdsptc_strand_run (evdsptc_event_t* event){
+    evdsptc_strand_t* strand = (evdsptc_strand_t*)event->param;
+    evdsptc_event_t* next;
+    int budget;
+
+    for(budget = EVDSPTC_STRAND_BUDGET; 0 < budget; budget--){
+        pthread_mutex_lock(&strand->mtx);
+        next = (evdsptc_event_t*)evdsptc_list_pop(&strand->list);
+        if(next == NULL) strand->scheduled = false;
+        pthread_mutex_unlock(&strand->mtx);
+        if(next == NULL) return true;
+        evdsptc_event_run(strand->context, next);
+    }
+
+    // yields the worker to the other events and strands. the strand stays scheduled.
+    evdsptc_post(strand->context, event);
+    return true;
+}
+
+// cancels the pending events of the strand. unschedule is false while the strand event may be still queued.
+static void evdsptc_strand_cancel (evdsptc_strand_t* strand, bool unschedule){
+    evdsptc_list_t canceled;
+    evdsptc_event_t* event;
+
+    evdsptc_list_init(&canceled);
+    pthread_mutex_lock(&strand->mtx);
+    while(NULL != (event = (evdsptc_event_t*)evdsptc_list_pop(&strand->list))) evdsptc_list_push(&canceled, &event->listelem);
+    if(unschedule) strand->scheduled = false;
+    pthread_mutex_unlock(&strand->mtx);
+
+    evdsptc_list_drop(strand->context, &canceled);
+}
+
+evdsptc_error_t evdsptc_strand_init (evdsptc_strand_t* strand, evdsptc_context_t* context){
+    if(context->type == EVDSPTC_TYPE_PERIODIC) return EVDSPTC_ERROR_INVALID;
+    if(0 != pthread_mutex_init(&strand->mtx, evdsptc_pmutexattrinitializer)) return EVDSPTC_ERROR_FAIL_INIT_MUTEX;
+
+    evdsptc_event_init(&strand->event, evdsptc_strand_run, (void*)strand, false, NULL);
+    strand->context = context;
+    evdsptc_list_init(&strand->list);
+    strand->scheduled = false;
+    return EVDSPTC_ERROR_NONE;
+}
+
+evdsptc_error_t evdsptc_strand_post (evdsptc_strand_t* strand, evdsptc_event_t* event){
+    evdsptc_context_t* context = strand->context;
+    evdsptc_error_t ret = EVDSPTC_ERROR_NONE;
+    bool schedule;
+    bool counted = evdsptc_queue_iscounted(context, event);
+    int queued;
+
+    if(EVDSPTC_TIMERTYPE_IMMEDIATE != event->timertype){
+        evdsptc_event_drop(context, event);
+        return EVDSPTC_ERROR_INVALID;
+    }
+    if(counted){
+        if(0 > (queued = evdsptc_queue_reserve(context, 1))){
+            evdsptc_event_drop(context, event);
+            return EVDSPTC_ERROR_FULL;
+        }
+        evdsptc_queue_notifyhigh(context, queued);
+    }
+    evdsptc_event_rearm(event);
+    event->counted = counted;
+    if(__atomic_load_n(&context->instrumented, __ATOMIC_RELAXED)) clock_gettime(CLOCK_MONOTONIC, &event->queued_time);
+    event->context = context;
+    evdsptc_event_queued(context, event);
+
+    pthread_mutex_lock(&strand->mtx);
+    evdsptc_list_push(&strand->list, &event->listelem);
+    schedule = !strand->scheduled;
+    strand->scheduled = true;
+    pthread_mutex_unlock(&strand->mtx);
+
+    // the strand event cancels the events of the strand if it fails.
+    if(schedule) ret = evdsptc_post(context, &strand->event);
+    return ret;
+}
+
+void evdsptc_strand_destroy (evdsptc_strand_t* strand){
+    bool scheduled = true;
+
+    evdsptc_strand_cancel(strand, false);
+    // the strand event may be still queued on the event dispatcher. it finds the strand empty and unschedules it.
+    while(scheduled){
+        pthread_mutex_lock(&strand->mtx);
+        scheduled = strand->scheduled;
+        pthread_mutex_unlock(&strand->mtx);
+        if(scheduled) sched_yield();
+    }
+    pthread_mutex_destroy(&strand->mtx);
+}
+
+int evdsptc_getcompletionfd (evdsptc_context_t* context){
+#ifdef __linux__
+    int fd;
+
+    pthread_mutex_lock(&context->mtx);
+    if(context->completion_fd < 0 && context->state == EVDSPTC_STATUS_RUNNING)
+        __atomic_store_n(&context->completion_fd, eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), __ATOMIC_RELEASE);
+    fd = context->completion_fd;
+    pthread_mutex_unlock(&context->mtx);
+    return fd;
+#else
+    (void)context;
+    return -1;
+#endif
+}
+
+int evdsptc_reapcompletions (evdsptc_context_t* context, evdsptc_event_t** events, int max){
+    int n = 0;
+
+    if(__atomic_load_n(&context->completion_fd, __ATOMIC_ACQUIRE) < 0) return 0;
+    pthread_mutex_lock(&context->completion_mtx);
+#ifdef __linux__
+    if(context->completion_signaled) evdsptc_eventfd_clear(context->completion_fd);
+#endif
+    while(n < max && NULL != (events[n] = (evdsptc_event_t*)evdsptc_list_pop(&context->completion_list))) n++;
+    // the fd stays readable while completions are left.
+    context->completion_signaled = !evdsptc_list_isempty(&context->completion_list);
+#ifdef __linux__
+    if(context->completion_signaled) evdsptc_eventfd_signal(context->completion_fd);
+#endif
+    pthread_mutex_unlock(&context->completion_mtx);
+    return n;
+}
+
+int evdsptc_getreadyfd (evdsptc_context_t* context){
+#ifdef __linux__
+    int fd;
+
+    pthread_mutex_lock(&context->mtx);
+    if(context->ready_fd < 0 && context->state == EVDSPTC_STATUS_RUNNING && context->type == EVDSPTC_TYPE_NORMAL){
+        context->ready_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        context->ready_signaled = false;
+        if(0 <= context->ready_fd && (!evdsptc_ready_isempty(context) || !evdsptc_timer_isempty(context))){
+            evdsptc_eventfd_signal(context->ready_fd);
+            context->ready_signaled = true;
+        }
+    }
+    fd = context->ready_fd;
+    pthread_mutex_unlock(&context->mtx);
+    return fd;
+#else
+    (void)context;
+    return -1;
+#endif
+}
+
+int evdsptc_dispatch (evdsptc_context_t* context, struct timespec* timeout){
+    evdsptc_event_t* events[EVDSPTC_MAX_BATCH_SIZE];
+    struct timespec* nearest;
+    struct timespec now;
+    bool expired;
+    int n = 0;
+
+    if(context->type != EVDSPTC_TYPE_NORMAL) return -1;
+    pthread_mutex_lock(&context->mtx);
+#ifdef __linux__
+    if(0 <= context->ready_fd && context->ready_signaled) evdsptc_eventfd_clear(context->ready_fd);
+#endif
+    context->ready_signaled = false;
+    if(context->state == EVDSPTC_STATUS_RUNNING) n = evdsptc_dequeue(context, events);
+    // the fd stays readable while queued events or expired timer events beyond the batch are left.
+    expired = evdsptc_timer_hasexpired(context);
+    if(expired || !evdsptc_ready_isempty(context)){
+#ifdef __linux__
+        if(0 <= context->ready_fd) evdsptc_eventfd_signal(context->ready_fd);
+#endif
+        context->ready_signaled = true;
+    }
+    if(timeout != NULL){
+        nearest = evdsptc_timer_nearest(context);
+        if(expired){
+            timeout->tv_sec = 0;
+            timeout->tv_nsec = 0;
+        }else if(nearest == NULL){
+            timeout->tv_sec = -1;
+            timeout->tv_nsec = 0;
+        }else{
+            clock_gettime(CLOCK_REALTIME, &now);
+            if(evdsptc_timespec_compare(nearest, &now) <= 0){
+                timeout->tv_sec = 0;
+                timeout->tv_nsec = 0;
+            }else{
+                timeout->tv_sec = nearest->tv_sec - now.tv_sec;
+                timeout->tv_nsec = nearest->tv_nsec - now.tv_nsec;
+                if(timeout->tv_nsec < 0){
+                    timeout->tv_sec--;
+                    timeout->tv_nsec += 1000 * 1000 * 1000;
+                }
+            }
+        }
+    }
+    pthread_mutex_unlock(&context->mtx);
+
+    if(n > 0) evdsptc_events_run(context, events, n);
+    return n;
+}
+
+#ifdef __linux__
+// removes the io from the epoll set and from the I/O events being handled. called by the reactor thread.
+static void evdsptc_io_remove (evdsptc_io_t* io){
+    evdsptc_context_t* context = io->context;
+    int i;
+
+    epoll_ctl(context->epoll_fd, EPOLL_CTL_DEL, io->fd, NULL);
+    for(i = 0; i < context->reactor_ready_num; i++){
+        if(context->reactor_ready[i].data.ptr == (void*)io) context->reactor_ready[i].data.ptr = NULL;
+    }
+    io->context = NULL;
+}
+#endif
+
+evdsptc_error_t evdsptc_io_register (evdsptc_context_t* context, evdsptc_io_t* io, int fd, uint32_t events, evdsptc_io_handler_t handler, void* param){
+#ifdef __linux__
+    struct epoll_event ev;
+
+    if(context->type != EVDSPTC_TYPE_REACTOR || context->state != EVDSPTC_STATUS_RUNNING || handler == NULL) return EVDSPTC_ERROR_INVALID;
+    io->context = context;
+    io->fd = fd;
+    io->events = events;
+    io->handler = handler;
+    io->param = param;
+    ev.events = events;
+    ev.data.ptr = io;
+    if(0 != epoll_ctl(context->epoll_fd, EPOLL_CTL_ADD, fd, &ev)){
+        io->context = NULL;
+        return EVDSPTC_ERROR_FAIL_INIT_IO;
+    }
+    return EVDSPTC_ERROR_NONE;
+#else
+    (void)context; (void)io; (void)fd; (void)events; (void)handler; (void)param;
+    return EVDSPTC_ERROR_INVALID;
+#endif
+}
+
+evdsptc_error_t evdsptc_io_modify (evdsptc_io_t* io, uint32_t events){
+#ifdef __linux__
+    struct epoll_event ev;
+
+    if(io->context == NULL) return EVDSPTC_ERROR_INVALID;
+    ev.events = events;
+    ev.data.ptr = io;
+    if(0 != epoll_ctl(io->context->epoll_fd, EPOLL_CTL_MOD, io->fd, &ev)) return EVDSPTC_ERROR_FAIL_INIT_IO;
+    io->events = events;
+    return EVDSPTC_ERROR_NONE;
+#else
+    (void)io; (void)events;
+    return EVDSPTC_ERROR_INVALID;
+#endif
+}
+
+evdsptc_error_t evdsptc_io_unregister (evdsptc_io_t* io){
+#ifdef __linux__
+    evdsptc_context_t* context = io->context;
+    unsigned long int round;
+
+    if(context == NULL) return EVDSPTC_ERROR_INVALID;
+    if(evdsptc_current_worker != NULL && evdsptc_current_worker->context == context){
+        evdsptc_io_remove(io);
+        return EVDSPTC_ERROR_NONE;
+    }
+    // the I/O events already taken by the reactor thread may still name the io, so waits for the next round.
+    pthread_mutex_lock(&context->mtx);
+    epoll_ctl(context->epoll_fd, EPOLL_CTL_DEL, io->fd, NULL);
+    io->context = NULL;
+    round = context->reactor_round;
+    context->reactor_waiters++;
+    while(context->state == EVDSPTC_STATUS_RUNNING && context->reactor_round == round){
+        evdsptc_reactor_wakeup(context);
+        pthread_cond_wait(&context->cv, &context->mtx);
+    }
+    context->reactor_waiters--;
+    pthread_mutex_unlock(&context->mtx);
+    return EVDSPTC_ERROR_NONE;
+#else
+    (void)io;
+    return EVDSPTC_ERROR_INVALID;
+#endif
+}
@@ -12,9 +12,21 @@ extern "C" {
 #include <unistd.h>
 #include <errno.h>
 #include <stdio.h>
+#include <stdint.h>
 
 #define EVDSPTC_MAX_THREADS (256)
+#define EVDSPTC_MAX_BATCH_SIZE (64)
+#define EVDSPTC_WHEEL_BITS (6)
+#define EVDSPTC_WHEEL_SLOTS (1 << EVDSPTC_WHEEL_BITS)
+#define EVDSPTC_WHEEL_LEVELS (5)
+#define EVDSPTC_EVENTPOOL_SHARDS (8)
+#define EVDSPTC_PRIORITY_LEVELS (32)
+#define EVDSPTC_PERIOD_SLOTS (64)
+#define EVDSPTC_THREADATTR_INHERIT (-1)
+#define EVDSPTC_HISTOGRAM_SUBBITS (2)
+#define EVDSPTC_HISTOGRAM_BUCKETS (64 << EVDSPTC_HISTOGRAM_SUBBITS)
 
+//#define EVDSPTC_BROADCAST_WAKEUP
 //#define EVDSPTRACE
 #ifdef EVDSPTRACE
 #define EVDSPTC_TRACE(fmt, ...) printf("##TRACE## %p:%s(): " fmt "\n", (void*)pthread_self(), __func__, ##__VA_ARGS__); fflush(stdout)/* parasoft suppress all */
@@ -29,7 +41,11 @@ typedef enum{
     EVDSPTC_ERROR_INVALID,
     EVDSPTC_ERROR_NOT_DONE,
     EVDSPTC_ERROR_FAIL_INIT_MUTEX,
-    EVDSPTC_ERROR_FAIL_INIT_COND
+    EVDSPTC_ERROR_FAIL_INIT_COND,
+    EVDSPTC_ERROR_FAIL_ALLOC_MEMORY,
+    EVDSPTC_ERROR_POOL_EXHAUSTED,
+    EVDSPTC_ERROR_FULL,
+    EVDSPTC_ERROR_FAIL_INIT_IO
 } evdsptc_error_t;
 
 typedef enum{
@@ -45,17 +61,51 @@ typedef enum{
     EVDSPTC_TIMERTYPE_ABSOLUTE
 } evdsptc_timertype_t;
 
+typedef enum{
+    EVDSPTC_OVERRUNPOLICY_SHIFT = 0,
+    EVDSPTC_OVERRUNPOLICY_SKIP,
+    EVDSPTC_OVERRUNPOLICY_CATCHUP
+} evdsptc_overrunpolicy_t;
+
+typedef enum{
+    EVDSPTC_TIMERBACKEND_LIST = 0,
+    EVDSPTC_TIMERBACKEND_WHEEL,
+    EVDSPTC_TIMERBACKEND_TIMERFD
+} evdsptc_timerbackend_t;
+
+typedef enum{
+    EVDSPTC_SCHEDPOLICY_PRIORITY = 0,
+    EVDSPTC_SCHEDPOLICY_EDF
+} evdsptc_schedpolicy_t;
+
 typedef enum{
     EVDSPTC_TYPE_NORMAL = 0,
-    EVDSPTC_TYPE_PERIODIC
+    EVDSPTC_TYPE_PERIODIC,
+    EVDSPTC_TYPE_LOCKFREE,
+    EVDSPTC_TYPE_WORKSTEALING,
+    EVDSPTC_TYPE_REACTOR
 } evdsptc_type_t;
 
 typedef struct evdsptc_list evdsptc_list_t;
 typedef struct evdsptc_listelem evdsptc_listelem_t;
 typedef struct evdsptc_event evdsptc_event_t;
 typedef struct evdsptc_context evdsptc_context_t;
+typedef struct evdsptc_worker evdsptc_worker_t;
+typedef struct evdsptc_timerwheel evdsptc_timerwheel_t;
+typedef struct evdsptc_eventpool evdsptc_eventpool_t;
+typedef struct evdsptc_histogram evdsptc_histogram_t;
+typedef struct evdsptc_periodstats evdsptc_periodstats_t;
+typedef struct evdsptc_eventstats evdsptc_eventstats_t;
+typedef struct evdsptc_threadattr evdsptc_threadattr_t;
+typedef struct evdsptc_strand evdsptc_strand_t;
+typedef struct evdsptc_io evdsptc_io_t;
+typedef struct evdsptc_eventpool_shard evdsptc_eventpool_shard_t;
+struct epoll_event;
 typedef bool (*evdsptc_handler_t)(evdsptc_event_t* event);
+typedef bool (*evdsptc_batch_handler_t)(evdsptc_event_t** events, int n);
 typedef void (*evdsptc_event_callback_t)(evdsptc_event_t* event);
+typedef void (*evdsptc_watermark_callback_t)(evdsptc_context_t* context);
+typedef void (*evdsptc_io_handler_t)(evdsptc_io_t* io, uint32_t events);
 typedef void (*evdsptc_listelem_destructor_t)(evdsptc_listelem_t* listelem);
 typedef void (*evdsptc_event_destructor_t)(evdsptc_event_t* event);
 
@@ -74,21 +124,187 @@ struct evdsptc_event {
     evdsptc_listelem_t listelem;
     evdsptc_context_t* context;
     evdsptc_handler_t handler;
+    evdsptc_batch_handler_t batch_handler;
     void* param;
-    bool is_done;
-    bool is_canceled;
-    sem_t sem;
-    bool auto_destruct;
     evdsptc_event_destructor_t destructor;
     struct timespec timer;
+    struct timespec queued_time;
+    struct timespec deadline;
+    unsigned long long int key;
+    unsigned long long int coalesce_key;
+    evdsptc_event_t* coalesce_next;
+    // the absolute deadline in the EDF heap and the period of a periodic event dispatcher are never needed in the same context.
+    // due_ns is computed on posting, so that the deadline set by the user is kept as it is.
+    union {
+        long long int due_ns;
+        unsigned long long int next_period;
+    };
     evdsptc_timertype_t timertype;
+    evdsptc_timertype_t deadlinetype;
+    int priority;
+    int heap_index;
+    unsigned int sequence;
+    unsigned int rate_divisor;
+    unsigned int rate_phase;
+#ifdef __linux__
+    volatile int completion;
+#else
+    sem_t sem;
+#endif
+    bool is_done;
+    bool is_canceled;
+    bool auto_destruct;
+    bool keyed;
+    bool coalescing;
+    bool counted;
+};
+
+struct evdsptc_timerwheel {
+    long long int resolution_ns;
+    struct timespec origin;
+    unsigned long long int base;
+    unsigned long long int bitmap[EVDSPTC_WHEEL_LEVELS];
+    evdsptc_list_t slots[EVDSPTC_WHEEL_LEVELS][EVDSPTC_WHEEL_SLOTS];
+    evdsptc_list_t overflow;
+    evdsptc_list_t expired;
+    struct timespec nearest;
+};
+
+// a shard is a locked free list shared by the threads mapped to it, not a lock-free per-thread cache.
+// outstanding is the number of events taken from the shard minus those returned to it.
+struct evdsptc_eventpool_shard {
+    pthread_mutex_t mtx;
+    evdsptc_list_t list;
+    int outstanding;
+};
+
+struct evdsptc_eventpool {
+    void* storage;
+    int capacity;
+    evdsptc_eventpool_shard_t shards[EVDSPTC_EVENTPOOL_SHARDS];
+    volatile unsigned long long int exhausted_count;
+};
+
+struct evdsptc_histogram {
+    unsigned long long int count;
+    unsigned long long int sum;
+    long long int min;
+    long long int max;
+    unsigned long long int buckets[EVDSPTC_HISTOGRAM_BUCKETS];
+};
+
+struct evdsptc_periodstats {
+    unsigned long long int cycles;
+    unsigned long long int overruns;
+    unsigned long long int missed;
+    evdsptc_histogram_t latency;
+    evdsptc_histogram_t exec;
+};
+
+struct evdsptc_eventstats {
+    evdsptc_histogram_t wait;
+    evdsptc_histogram_t service;
+};
+
+struct evdsptc_threadattr {
+    const int* cpus;
+    int cpus_num;
+    int policy;
+    int priority;
+    size_t stacksize;
+    const char* name;
+};
+
+struct evdsptc_io {
+    evdsptc_context_t* context;
+    int fd;
+    uint32_t events;
+    evdsptc_io_handler_t handler;
+    void* param;
+};
+
+struct evdsptc_strand {
+    evdsptc_event_t event;
+    evdsptc_context_t* context;
+    pthread_mutex_t mtx;
+    evdsptc_list_t list;
+    bool scheduled;
+};
+
+struct evdsptc_worker {
+    evdsptc_listelem_t listelem;
+    evdsptc_context_t* context;
+    int index;
+    pthread_mutex_t mtx;
+    pthread_cond_t cv;
+    bool notified;
+    evdsptc_list_t deque;
+    volatile int depth;
+    evdsptc_list_t keyed;
+    char name[16];
+    bool active;
+    bool joinable;
 };
 
 struct evdsptc_context {
     evdsptc_list_t list;
+    evdsptc_list_t priority_list[EVDSPTC_PRIORITY_LEVELS - 1];
+    volatile unsigned int priority_bitmap;
+    struct timespec priority_aging;
+    evdsptc_schedpolicy_t sched_policy;
+    bool drop_missed;
+    evdsptc_event_t** edf_heap;
+    int edf_num;
+    int edf_capacity;
+    unsigned long long int edf_sequence;
+    volatile unsigned long long int deadline_miss_count;
+    evdsptc_event_t** coalesce_table;
+    int coalesce_capacity;
+    int coalesce_num;
+    volatile bool bounded;
+    volatile int capacity;
+    volatile int queued_num;
+    int high_watermark;
+    int low_watermark;
+    evdsptc_watermark_callback_t high_callback;
+    evdsptc_watermark_callback_t low_callback;
+    volatile bool congested;
+    pthread_cond_t space_cv;
+    volatile int space_waiters;
+    int completion_fd;
+    pthread_mutex_t completion_mtx;
+    evdsptc_list_t completion_list;
+    bool completion_signaled;
+    int ready_fd;
+    bool ready_signaled;
+    int epoll_fd;
+    int reactor_fd;
+    volatile bool reactor_polling;
+    struct epoll_event* reactor_ready;
+    int reactor_ready_num;
+    unsigned long int reactor_round;
+    int reactor_waiters;
     evdsptc_list_t timer_list;
+    evdsptc_timerbackend_t timer_backend;
+    evdsptc_timerwheel_t* timer_wheel;
+    volatile int timer_num;
+    evdsptc_list_t timer_monolist;
+    int timer_monofd;
+    int timer_realfd;
+    int timer_kickfd;
+    bool timer_threaded;
+    pthread_t timer_thread;
+    int batch_size;
+    volatile bool instrumented;
+    evdsptc_eventstats_t* event_stats;
     int threads_num;
-    pthread_t th[EVDSPTC_MAX_THREADS];
+    int threads_min;
+    int threads_max;
+    struct timespec idle_timeout;
+    pthread_t* th;
+    evdsptc_worker_t* workers;
+    evdsptc_list_t idle_list;
+    volatile int idle_num;
     pthread_mutex_t mtx;
     pthread_cond_t cv;
     evdsptc_status_t state;
@@ -97,8 +313,22 @@ struct evdsptc_context {
     evdsptc_event_callback_t begin_callback;
     evdsptc_event_callback_t end_callback;
     struct timespec interval;
+    evdsptc_list_t* period_slots;
+    evdsptc_list_t period_due;
+    evdsptc_list_t period_handled;
+    struct timespec period_next;
+    unsigned long long int period_collected;
+    int period_arrived;
+    struct timespec period_woken;
+    evdsptc_overrunpolicy_t overrun_policy;
+    evdsptc_periodstats_t* period_stats;
     unsigned long long int period_count; 
     bool period_overrun;
+    evdsptc_listelem_t mpsc_stub;
+    evdsptc_listelem_t* mpsc_head;
+    evdsptc_listelem_t* mpsc_tail;
+    volatile int mpsc_parked;
+    volatile int mpsc_producers;
 };
 
 extern int evdsptc_timespec_compare (struct timespec* a, struct timespec* b);
@@ -120,21 +350,74 @@ extern evdsptc_error_t evdsptc_create (evdsptc_context_t* context,
         evdsptc_event_callback_t begin_callback,
         evdsptc_event_callback_t end_callback
         );
+extern evdsptc_error_t evdsptc_create_manual (evdsptc_context_t* context,
+        evdsptc_event_callback_t queued_callback,
+        evdsptc_event_callback_t begin_callback,
+        evdsptc_event_callback_t end_callback
+        );
 extern evdsptc_error_t evdsptc_create_threadpool (evdsptc_context_t* context,
         evdsptc_event_callback_t queued_callback,
         evdsptc_event_callback_t begin_callback,
         evdsptc_event_callback_t end_callback,
         int threads_num
         );
+extern evdsptc_error_t evdsptc_create_lockfree (evdsptc_context_t* context,
+        evdsptc_event_callback_t queued_callback,
+        evdsptc_event_callback_t begin_callback,
+        evdsptc_event_callback_t end_callback
+        );
+extern evdsptc_error_t evdsptc_create_reactor (evdsptc_context_t* context,
+        evdsptc_event_callback_t queued_callback,
+        evdsptc_event_callback_t begin_callback,
+        evdsptc_event_callback_t end_callback
+        );
+extern evdsptc_error_t evdsptc_create_workstealing (evdsptc_context_t* context,
+        evdsptc_event_callback_t queued_callback,
+        evdsptc_event_callback_t begin_callback,
+        evdsptc_event_callback_t end_callback,
+        int threads_num
+        );
 extern evdsptc_error_t evdsptc_create_periodic (evdsptc_context_t* context,
         evdsptc_event_callback_t queued_callback,
         evdsptc_event_callback_t begin_callback,
         evdsptc_event_callback_t end_callback,
         struct timespec* interval
         );
+extern evdsptc_error_t evdsptc_create_periodic_threadpool (evdsptc_context_t* context,
+        evdsptc_event_callback_t queued_callback,
+        evdsptc_event_callback_t begin_callback,
+        evdsptc_event_callback_t end_callback,
+        struct timespec* interval,
+        int threads_num
+        );
+extern evdsptc_error_t evdsptc_create_elastic (evdsptc_context_t* context,
+        evdsptc_event_callback_t queued_callback,
+        evdsptc_event_callback_t begin_callback,
+        evdsptc_event_callback_t end_callback,
+        int min_threads,
+        int max_threads,
+        struct timespec* idle_timeout
+        );
+extern evdsptc_error_t evdsptc_create_ex (evdsptc_context_t* context,
+        evdsptc_event_callback_t queued_callback,
+        evdsptc_event_callback_t begin_callback,
+        evdsptc_event_callback_t end_callback,
+        evdsptc_type_t type,
+        int threads_num,
+        struct timespec* interval,
+        evdsptc_threadattr_t* attrs
+        );
+extern void evdsptc_threadattr_init (evdsptc_threadattr_t* attr);
 extern evdsptc_error_t evdsptc_cancel (evdsptc_context_t* context);
 extern evdsptc_error_t evdsptc_destroy (evdsptc_context_t* context, bool join);
 extern evdsptc_error_t evdsptc_post (evdsptc_context_t* context, evdsptc_event_t* event);
+extern evdsptc_error_t evdsptc_trypost (evdsptc_context_t* context, evdsptc_event_t* event);
+extern evdsptc_error_t evdsptc_timedpost (evdsptc_context_t* context, evdsptc_event_t* event, struct timespec* timeout);
+extern evdsptc_error_t evdsptc_post_batch (evdsptc_context_t* context, evdsptc_event_t** events, int n);
+extern evdsptc_error_t evdsptc_post_list (evdsptc_context_t* context, evdsptc_list_t* list);
+extern evdsptc_error_t evdsptc_post_coalesce (evdsptc_context_t* context, evdsptc_event_t* event, unsigned long long int coalesce_key);
+extern evdsptc_error_t evdsptc_timer_cancel (evdsptc_context_t* context, evdsptc_event_t* event);
+extern evdsptc_error_t evdsptc_event_reschedule (evdsptc_context_t* context, evdsptc_event_t* event, struct timespec* timer, evdsptc_timertype_t type);
 extern evdsptc_error_t evdsptc_event_waitdone (evdsptc_event_t* event);
 extern evdsptc_error_t evdsptc_event_trywaitdone (evdsptc_event_t* event);
 extern evdsptc_error_t evdsptc_event_init (evdsptc_event_t* event,
@@ -145,6 +428,7 @@ extern evdsptc_error_t evdsptc_event_init (evdsptc_event_t* event,
 extern void* evdsptc_event_getparam(evdsptc_event_t* event);
 extern void evdsptc_event_free (evdsptc_event_t* event);
 extern pthread_t* evdsptc_getthreads(evdsptc_context_t* context);
+extern int evdsptc_getthreadsnum(evdsptc_context_t* context);
 extern pthread_mutex_t* evdsptc_getmutex(evdsptc_context_t* context);
 extern void evdsptc_setmutexattrinitializer(pthread_mutexattr_t* attr);
 extern void evdsptc_event_makedone (evdsptc_event_t* event);
@@ -154,8 +438,46 @@ extern void evdsptc_event_cancel (evdsptc_event_t* event);
 extern void evdsptc_event_setdestructor (evdsptc_event_t* event, evdsptc_event_destructor_t destructor);
 extern void evdsptc_event_setautodestruct (evdsptc_event_t* event, bool auto_destruct);
 extern void evdsptc_event_settimer (evdsptc_event_t* event, struct timespec* timer, evdsptc_timertype_t type);
+extern evdsptc_error_t evdsptc_io_register (evdsptc_context_t* context, evdsptc_io_t* io, int fd, uint32_t events,
+        evdsptc_io_handler_t handler, void* param);
+extern evdsptc_error_t evdsptc_io_modify (evdsptc_io_t* io, uint32_t events);
+extern evdsptc_error_t evdsptc_io_unregister (evdsptc_io_t* io);
+extern int evdsptc_getcompletionfd (evdsptc_context_t* context);
+extern int evdsptc_reapcompletions (evdsptc_context_t* context, evdsptc_event_t** events, int max);
+// the ready fd is not made readable when a timer event expires, except with EVDSPTC_TIMERBACKEND_TIMERFD.
+// otherwise the timeout set by evdsptc_dispatch must be used as the timeout of the epoll loop.
+extern int evdsptc_getreadyfd (evdsptc_context_t* context);
+extern int evdsptc_dispatch (evdsptc_context_t* context, struct timespec* timeout);
+extern evdsptc_error_t evdsptc_setcapacity (evdsptc_context_t* context, int capacity);
+extern evdsptc_error_t evdsptc_setwatermarks (evdsptc_context_t* context, int high_watermark, int low_watermark,
+        evdsptc_watermark_callback_t high_callback, evdsptc_watermark_callback_t low_callback);
+extern int evdsptc_getqueuednum (evdsptc_context_t* context);
+extern void evdsptc_event_setkey (evdsptc_event_t* event, unsigned long long int key);
+extern void evdsptc_event_setpriority (evdsptc_event_t* event, int priority);
+extern evdsptc_error_t evdsptc_setpriorityaging (evdsptc_context_t* context, struct timespec* aging);
+extern void evdsptc_event_setdeadline (evdsptc_event_t* event, struct timespec* deadline, evdsptc_timertype_t type);
+extern evdsptc_error_t evdsptc_event_setrate (evdsptc_event_t* event, unsigned int divisor, unsigned int phase);
+extern evdsptc_error_t evdsptc_setschedpolicy (evdsptc_context_t* context, evdsptc_schedpolicy_t policy, bool drop_missed);
+extern unsigned long long int evdsptc_getdeadlinemisscount (evdsptc_context_t* context);
+extern void evdsptc_event_setbatchhandler (evdsptc_event_t* event, evdsptc_batch_handler_t batch_handler);
+extern evdsptc_error_t evdsptc_setbatchsize (evdsptc_context_t* context, int batch_size);
+extern evdsptc_error_t evdsptc_settimerbackend (evdsptc_context_t* context, evdsptc_timerbackend_t backend, struct timespec* resolution);
+extern evdsptc_error_t evdsptc_eventpool_create (evdsptc_eventpool_t* pool, int capacity);
+extern evdsptc_error_t evdsptc_eventpool_destroy (evdsptc_eventpool_t* pool);
+extern evdsptc_error_t evdsptc_eventpool_alloc (evdsptc_eventpool_t* pool, evdsptc_event_t** event,
+        evdsptc_handler_t event_handler,
+        void* event_param);
+extern void evdsptc_eventpool_free (evdsptc_event_t* event);
 extern unsigned long long int evdsptc_getperiodcount(evdsptc_context_t* context);
 extern bool evdsptc_isperiodoverrun(evdsptc_context_t* context);
+extern evdsptc_error_t evdsptc_setoverrunpolicy (evdsptc_context_t* context, evdsptc_overrunpolicy_t policy);
+extern evdsptc_error_t evdsptc_getperiodstats (evdsptc_context_t* context, evdsptc_periodstats_t* stats, bool reset);
+extern evdsptc_error_t evdsptc_strand_init (evdsptc_strand_t* strand, evdsptc_context_t* context);
+extern evdsptc_error_t evdsptc_strand_post (evdsptc_strand_t* strand, evdsptc_event_t* event);
+extern void evdsptc_strand_destroy (evdsptc_strand_t* strand);
+extern evdsptc_error_t evdsptc_setinstrumentation (evdsptc_context_t* context, bool enable);
+extern evdsptc_error_t evdsptc_geteventstats (evdsptc_context_t* context, evdsptc_eventstats_t* stats, bool reset);
+extern long long int evdsptc_histogram_percentile (evdsptc_histogram_t* histogram, double percentile);
 
 #ifdef __cplusplus
 }
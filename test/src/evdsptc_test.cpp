@@ -1,6 +1,8 @@
 #include "evdsptc.h"
 
 #include <stdio.h>
+#include <poll.h>
+#include <fcntl.h>
 
 #include <CppUTest/CommandLineTestRunner.h>
 #include <CppUTest/TestHarness.h>
@@ -696,6 +698,1669 @@ TEST(evdsptc_test_group, periodic_destroy_test){
     }
 }
 
+static volatile int rate_ticks = 0;
+static int rate_calls[2][3];
+static volatile int rate_calls_num[2];
+
+static bool handle_rate_tick_event(evdsptc_event_t *event){
+    rate_ticks++;
+    return false;
+}
+
+static bool handle_rate_event(evdsptc_event_t *event){
+    int n = *(int*)evdsptc_event_getparam(event);
+    rate_calls[n][rate_calls_num[n]] = rate_ticks;
+    __sync_synchronize();
+    rate_calls_num[n]++;
+    return rate_calls_num[n] == 3;
+}
+
+TEST(evdsptc_test_group, periodic_rate_test){
+    evdsptc_context_t ctx;
+    evdsptc_event_t tick;
+    evdsptc_event_t event[2];
+    int index[2] = {0, 1};
+    unsigned int divisor[2] = {10, 70};
+    struct timespec intv = {0, 1000 * 1000};
+    int i;
+
+    rate_ticks = 0;
+    rate_calls_num[0] = 0;
+    rate_calls_num[1] = 0;
+
+    evdsptc_event_init(&tick, handle_rate_tick_event, NULL, false, NULL);
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_event_setrate(&tick, 0, 0));
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_event_setrate(&tick, 10, 10));
+    for(i = 0; i < 2; i++){
+        evdsptc_event_init(&event[i], handle_rate_event, &index[i], false, NULL);
+        CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_setrate(&event[i], divisor[i], i + 2));
+    }
+
+    evdsptc_create_periodic(&ctx, NULL, NULL, NULL, &intv);
+    post(&ctx, &tick, false);
+    post(&ctx, &event[0], false);
+    post(&ctx, &event[1], false);
+
+    i = 0;
+    while(!(evdsptc_event_isdone(&event[0]) && evdsptc_event_isdone(&event[1])) && i++ < USLEEP_TIMES) usleep(NUM_OF_USLEEP);
+    CHECK(evdsptc_event_isdone(&event[0]));
+    CHECK(evdsptc_event_isdone(&event[1]));
+
+    // the tick event runs every tick ahead of the others, so it counts the ticks between their calls.
+    for(i = 0; i < 2; i++){
+        CHECK_EQUAL((int)divisor[i], rate_calls[i][1] - rate_calls[i][0]);
+        CHECK_EQUAL((int)divisor[i], rate_calls[i][2] - rate_calls[i][1]);
+    }
+
+    evdsptc_destroy(&ctx, true);
+    CHECK(tick.is_canceled);
+}
+
+#define PERIODIC_POOL_THREADS (4)
+#define PERIODIC_POOL_EVENTS (8)
+#define PERIODIC_POOL_TICKS (5)
+
+static volatile int periodic_pool_calls[PERIODIC_POOL_EVENTS];
+static volatile bool periodic_pool_overtaken = false;
+static pthread_t periodic_pool_threads[PERIODIC_POOL_EVENTS * PERIODIC_POOL_TICKS];
+static volatile int periodic_pool_threads_num = 0;
+
+static bool handle_periodic_pool_event(evdsptc_event_t *event){
+    int n = *(int*)evdsptc_event_getparam(event);
+    int calls = periodic_pool_calls[n];
+    int i;
+
+    // no event may start the next tick before all the events finished the current one.
+    for(i = 0; i < PERIODIC_POOL_EVENTS; i++){
+        if(periodic_pool_calls[i] < calls) periodic_pool_overtaken = true;
+    }
+    periodic_pool_threads[__sync_fetch_and_add(&periodic_pool_threads_num, 1)] = pthread_self();
+    usleep(200);
+    __sync_fetch_and_add(&periodic_pool_calls[n], 1);
+    return periodic_pool_calls[n] == PERIODIC_POOL_TICKS;
+}
+
+TEST(evdsptc_test_group, periodic_threadpool_test){
+    evdsptc_context_t ctx;
+    evdsptc_event_t event[PERIODIC_POOL_EVENTS];
+    int index[PERIODIC_POOL_EVENTS];
+    evdsptc_list_t list;
+    struct timespec intv = {0, 5 * 1000 * 1000};
+    bool parallel = false;
+    int i;
+
+    periodic_pool_threads_num = 0;
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_create_periodic_threadpool(&ctx, NULL, NULL, NULL, &intv, PERIODIC_POOL_THREADS));
+    evdsptc_list_init(&list);
+    for(i = 0; i < PERIODIC_POOL_EVENTS; i++){
+        index[i] = i;
+        periodic_pool_calls[i] = 0;
+        evdsptc_event_init(&event[i], handle_periodic_pool_event, &index[i], false, NULL);
+        evdsptc_list_push(&list, &event[i].listelem);
+    }
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_post_list(&ctx, &list));
+
+    for(i = 0; i < PERIODIC_POOL_EVENTS; i++) CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&event[i]));
+    CHECK(!periodic_pool_overtaken);
+    CHECK_EQUAL(PERIODIC_POOL_EVENTS * PERIODIC_POOL_TICKS, periodic_pool_threads_num);
+    for(i = 1; i < periodic_pool_threads_num; i++){
+        if(!pthread_equal(periodic_pool_threads[0], periodic_pool_threads[i])) parallel = true;
+    }
+    CHECK(parallel);
+
+    evdsptc_destroy(&ctx, true);
+}
+
+static volatile int overrun_calls = 0;
+
+static bool handle_overrun_event(evdsptc_event_t *event){
+    overrun_calls++;
+    if(overrun_calls == 3) usleep(5 * 1000);
+    return overrun_calls == 8;
+}
+
+TEST(evdsptc_test_group, periodic_overrun_test){
+    evdsptc_context_t ctx;
+    evdsptc_event_t event;
+    evdsptc_periodstats_t stats;
+    evdsptc_overrunpolicy_t policy[3] = {EVDSPTC_OVERRUNPOLICY_SHIFT, EVDSPTC_OVERRUNPOLICY_SKIP, EVDSPTC_OVERRUNPOLICY_CATCHUP};
+    struct timespec intv = {0, 2 * 1000 * 1000};
+    unsigned long long int cycles;
+    int i;
+
+    for(i = 0; i < 3; i++){
+        overrun_calls = 0;
+        evdsptc_create_periodic(&ctx, NULL, NULL, NULL, &intv);
+        CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_setoverrunpolicy(&ctx, policy[i]));
+        evdsptc_event_init(&event, handle_overrun_event, NULL, false, NULL);
+        post(&ctx, &event, true);
+
+        CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_getperiodstats(&ctx, &stats, true));
+        CHECK(8 <= evdsptc_getperiodcount(&ctx));
+        CHECK(8 <= stats.cycles);
+        cycles = stats.cycles;
+        CHECK(1 <= stats.overruns);
+        if(policy[i] == EVDSPTC_OVERRUNPOLICY_SKIP) CHECK(2 <= stats.missed);
+        else CHECK_EQUAL(0, stats.missed);
+        CHECK_EQUAL(stats.cycles, stats.exec.count);
+        CHECK(5 * 1000 * 1000 <= stats.exec.max);
+        CHECK(stats.latency.min <= evdsptc_histogram_percentile(&stats.latency, 50.0));
+        CHECK(evdsptc_histogram_percentile(&stats.latency, 50.0) <= evdsptc_histogram_percentile(&stats.latency, 99.0));
+        CHECK(evdsptc_histogram_percentile(&stats.latency, 99.0) <= stats.latency.max);
+
+        CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_getperiodstats(&ctx, &stats, false));
+        CHECK(stats.cycles < cycles);
+        evdsptc_destroy(&ctx, true);
+    }
+}
+
+static bool handle_slow_event(evdsptc_event_t *event){
+    usleep(1000);
+    return true;
+}
+
+TEST(evdsptc_test_group, eventstats_test){
+    evdsptc_context_t ctx;
+    evdsptc_event_t event[8];
+    evdsptc_eventstats_t stats;
+    int i;
+
+    evdsptc_create_threadpool(&ctx, NULL, NULL, NULL, 2);
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_geteventstats(&ctx, &stats, false));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_setinstrumentation(&ctx, true));
+
+    for(i = 0; i < 8; i++){
+        evdsptc_event_init(&event[i], handle_slow_event, NULL, false, NULL);
+        post(&ctx, &event[i], false);
+    }
+    for(i = 0; i < 8; i++) evdsptc_event_waitdone(&event[i]);
+
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_geteventstats(&ctx, &stats, true));
+    CHECK_EQUAL(8, stats.wait.count);
+    CHECK_EQUAL(8, stats.service.count);
+    CHECK(1000 * 1000 <= stats.service.min);
+    CHECK(stats.service.min <= evdsptc_histogram_percentile(&stats.service, 50.0));
+    CHECK(evdsptc_histogram_percentile(&stats.service, 99.0) <= stats.service.max);
+    // 8 events of 1 ms on 2 threads, so the last ones wait for the first ones.
+    CHECK(1000 * 1000 <= stats.wait.max);
+
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_geteventstats(&ctx, &stats, false));
+    CHECK_EQUAL(0, stats.wait.count);
+    CHECK_EQUAL(0, stats.service.count);
+
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_setinstrumentation(&ctx, false));
+    post(&ctx, &event[0], true);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_geteventstats(&ctx, &stats, false));
+    CHECK_EQUAL(0, stats.service.count);
+
+    evdsptc_destroy(&ctx, true);
+}
+
+static char threadattr_name[16];
+static bool threadattr_pinned = false;
+
+static bool handle_threadattr_event(evdsptc_event_t *event){
+    cpu_set_t cpuset;
+
+    pthread_getname_np(pthread_self(), threadattr_name, sizeof(threadattr_name));
+    pthread_getaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+    threadattr_pinned = (CPU_COUNT(&cpuset) == 1 && CPU_ISSET(0, &cpuset));
+    return true;
+}
+
+TEST(evdsptc_test_group, threadattr_test){
+    evdsptc_context_t ctx;
+    evdsptc_event_t event;
+    evdsptc_threadattr_t attr;
+    evdsptc_threadattr_t attrs[2];
+    struct timespec intv = {0, 1000 * 1000};
+    int cpus[1] = {0};
+
+    evdsptc_threadattr_init(&attr);
+    attr.cpus = cpus;
+    attr.cpus_num = 1;
+    attr.stacksize = 256 * 1024;
+    attr.name = "evdsptc-worker";
+
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_create_ex(&ctx, NULL, NULL, NULL, EVDSPTC_TYPE_LOCKFREE, 2, NULL, NULL));
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_create_ex(&ctx, NULL, NULL, NULL, EVDSPTC_TYPE_PERIODIC, 1, NULL, NULL));
+
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_create_ex(&ctx, NULL, NULL, NULL, EVDSPTC_TYPE_NORMAL, 1, NULL, &attr));
+    evdsptc_event_init(&event, handle_threadattr_event, NULL, false, NULL);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, post(&ctx, &event, true));
+    STRCMP_EQUAL("evdsptc-worker", threadattr_name);
+    CHECK(threadattr_pinned);
+    evdsptc_destroy(&ctx, true);
+
+    threadattr_pinned = false;
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_create_ex(&ctx, NULL, NULL, NULL, EVDSPTC_TYPE_PERIODIC, 1, &intv, &attr));
+    evdsptc_event_init(&event, handle_threadattr_event, NULL, false, NULL);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, post(&ctx, &event, true));
+    CHECK(threadattr_pinned);
+    evdsptc_destroy(&ctx, true);
+
+    // the threads already started are joined when a later one fails to start.
+    evdsptc_threadattr_init(&attrs[0]);
+    evdsptc_threadattr_init(&attrs[1]);
+    attrs[1].stacksize = 1;
+    CHECK_EQUAL(EVDSPTC_ERROR_FAIL_CREATE_THREAD, evdsptc_create_ex(&ctx, NULL, NULL, NULL, EVDSPTC_TYPE_NORMAL, 2, NULL, attrs));
+    CHECK_EQUAL(0, evdsptc_getthreadsnum(&ctx));
+    CHECK(NULL == evdsptc_getthreads(&ctx));
+    CHECK_EQUAL(EVDSPTC_ERROR_FAIL_CREATE_THREAD, evdsptc_create_ex(&ctx, NULL, NULL, NULL, EVDSPTC_TYPE_PERIODIC, 2, &intv, attrs));
+    CHECK_EQUAL(0, evdsptc_getthreadsnum(&ctx));
+}
+
+static bool handle_elastic_event(evdsptc_event_t *event){
+    usleep(20 * 1000);
+    return true;
+}
+
+TEST(evdsptc_test_group, elastic_test){
+    evdsptc_context_t ctx;
+    evdsptc_event_t event[8];
+    struct timespec idle = {0, 50 * 1000 * 1000};
+    struct timespec timer = {0, 20 * 1000 * 1000};
+    int i;
+
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_create_elastic(&ctx, NULL, NULL, NULL, 0, 4, &idle));
+    CHECK_EQUAL(0, evdsptc_getthreadsnum(&ctx));
+
+    for(i = 0; i < 8; i++){
+        evdsptc_event_init(&event[i], handle_elastic_event, NULL, false, NULL);
+        post(&ctx, &event[i], false);
+    }
+    CHECK(1 < evdsptc_getthreadsnum(&ctx));
+    CHECK(evdsptc_getthreadsnum(&ctx) <= 4);
+    for(i = 0; i < 8; i++) CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&event[i]));
+
+    i = 0;
+    while(0 < evdsptc_getthreadsnum(&ctx) && i++ < USLEEP_TIMES) usleep(NUM_OF_USLEEP);
+    CHECK_EQUAL(0, evdsptc_getthreadsnum(&ctx));
+
+    // retired threads are replaced on demand, also for timer events.
+    evdsptc_event_init(&event[0], handle_elastic_event, NULL, false, NULL);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, post(&ctx, &event[0], true));
+    evdsptc_event_init(&event[1], handle_elastic_event, NULL, false, NULL);
+    evdsptc_event_settimer(&event[1], &timer, EVDSPTC_TIMERTYPE_RELATIVE);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, post(&ctx, &event[1], true));
+    CHECK(1 <= evdsptc_getthreadsnum(&ctx));
+
+    evdsptc_destroy(&ctx, true);
+}
+
+#define KEYED_KEYS (8)
+#define KEYED_EVENTS (100)
+
+static volatile int keyed_running[KEYED_KEYS];
+static volatile long keyed_last_seq[KEYED_KEYS];
+static pthread_t keyed_thread[KEYED_KEYS];
+static volatile int keyed_errors = 0;
+
+static bool handle_keyed_event(evdsptc_event_t *event){
+    long param = (long)evdsptc_event_getparam(event);
+    int key = (int)(param / KEYED_EVENTS);
+    long seq = param % KEYED_EVENTS;
+    if(0 != __sync_fetch_and_add(&keyed_running[key], 1)) __sync_fetch_and_add(&keyed_errors, 1);
+    if(keyed_last_seq[key] + 1 != seq) __sync_fetch_and_add(&keyed_errors, 1);
+    if(seq == 0) keyed_thread[key] = pthread_self();
+    else if(!pthread_equal(keyed_thread[key], pthread_self())) __sync_fetch_and_add(&keyed_errors, 1);
+    keyed_last_seq[key] = seq;
+    __sync_fetch_and_sub(&keyed_running[key], 1);
+    return true;
+}
+
+static void keyed_run(evdsptc_context_t* ctx){
+    evdsptc_event_t* events = (evdsptc_event_t*)malloc(sizeof(evdsptc_event_t) * KEYED_KEYS * KEYED_EVENTS);
+    evdsptc_event_t free_events[KEYED_EVENTS];
+    int i;
+    int j;
+
+    for(i = 0; i < KEYED_KEYS; i++){
+        keyed_running[i] = 0;
+        keyed_last_seq[i] = -1;
+    }
+    keyed_errors = 0;
+
+    for(j = 0; j < KEYED_EVENTS; j++){
+        for(i = 0; i < KEYED_KEYS; i++){
+            evdsptc_event_init(&events[i * KEYED_EVENTS + j], handle_keyed_event, (void*)(long)(i * KEYED_EVENTS + j), false, NULL);
+            evdsptc_event_setkey(&events[i * KEYED_EVENTS + j], 1000 + i);
+            CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_post(ctx, &events[i * KEYED_EVENTS + j]));
+        }
+        // events without a key are balanced over all the workers.
+        evdsptc_event_init(&free_events[j], handle_inc_event, NULL, false, NULL);
+        CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_post(ctx, &free_events[j]));
+    }
+    for(i = 0; i < KEYED_KEYS * KEYED_EVENTS; i++) CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&events[i]));
+    for(i = 0; i < KEYED_EVENTS; i++) CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&free_events[i]));
+    CHECK_EQUAL(0, keyed_errors);
+    for(i = 0; i < KEYED_KEYS; i++) CHECK_EQUAL(KEYED_EVENTS - 1, keyed_last_seq[i]);
+    free(events);
+}
+
+TEST(evdsptc_test_group, keyed_test){
+    evdsptc_context_t ctx;
+    struct timespec idle = {0, 10 * 1000 * 1000};
+
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_create_threadpool(&ctx, NULL, NULL, NULL, 4));
+    keyed_run(&ctx);
+    evdsptc_destroy(&ctx, true);
+
+    // retired owners of elastic pools are started again for their keys.
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_create_elastic(&ctx, NULL, NULL, NULL, 0, 4, &idle));
+    keyed_run(&ctx);
+    usleep(50 * 1000);
+    keyed_run(&ctx);
+    evdsptc_destroy(&ctx, true);
+}
+
+#define STRAND_NUM (16)
+#define STRAND_EVENTS (50)
+
+static volatile int strand_running[STRAND_NUM];
+static volatile long strand_last_seq[STRAND_NUM];
+static volatile int strand_errors = 0;
+
+static bool handle_strand_event(evdsptc_event_t *event){
+    long param = (long)evdsptc_event_getparam(event);
+    int strand = (int)(param / STRAND_EVENTS);
+    long seq = param % STRAND_EVENTS;
+    if(0 != __sync_fetch_and_add(&strand_running[strand], 1)) __sync_fetch_and_add(&strand_errors, 1);
+    if(strand_last_seq[strand] + 1 != seq) __sync_fetch_and_add(&strand_errors, 1);
+    strand_last_seq[strand] = seq;
+    usleep(10);
+    __sync_fetch_and_sub(&strand_running[strand], 1);
+    return true;
+}
+
+TEST(evdsptc_test_group, strand_test){
+    evdsptc_context_t ctx;
+    evdsptc_context_t periodic;
+    struct timespec interval = {0, 10 * 1000 * 1000};
+    evdsptc_strand_t strands[STRAND_NUM];
+    evdsptc_event_t* events = (evdsptc_event_t*)malloc(sizeof(evdsptc_event_t) * STRAND_NUM * STRAND_EVENTS);
+    evdsptc_event_t event;
+    int i;
+    int j;
+
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_create_threadpool(&ctx, NULL, NULL, NULL, 4));
+    for(i = 0; i < STRAND_NUM; i++){
+        strand_running[i] = 0;
+        strand_last_seq[i] = -1;
+        CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_strand_init(&strands[i], &ctx));
+    }
+    strand_errors = 0;
+
+    for(j = 0; j < STRAND_EVENTS; j++){
+        for(i = 0; i < STRAND_NUM; i++){
+            evdsptc_event_init(&events[i * STRAND_EVENTS + j], handle_strand_event, (void*)(long)(i * STRAND_EVENTS + j), false, NULL);
+            CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_strand_post(&strands[i], &events[i * STRAND_EVENTS + j]));
+        }
+    }
+    for(i = 0; i < STRAND_NUM * STRAND_EVENTS; i++) CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&events[i]));
+    CHECK_EQUAL(0, strand_errors);
+    for(i = 0; i < STRAND_NUM; i++) CHECK_EQUAL(STRAND_EVENTS - 1, strand_last_seq[i]);
+
+    // only immediate events are serialized by strands.
+    evdsptc_event_init(&event, handle_strand_event, NULL, false, NULL);
+    evdsptc_event_settimer(&event, &interval, EVDSPTC_TIMERTYPE_RELATIVE);
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_strand_post(&strands[0], &event));
+    CHECK(event.is_canceled);
+
+    for(i = 0; i < STRAND_NUM; i++) evdsptc_strand_destroy(&strands[i]);
+    evdsptc_destroy(&ctx, true);
+    free(events);
+
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_create_periodic(&periodic, NULL, NULL, NULL, &interval));
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_strand_init(&strands[0], &periodic));
+    evdsptc_destroy(&periodic, true);
+}
+
+static void* release_sem_routine(void* arg){
+    usleep(50 * 1000);
+    sem_post((sem_t*)arg);
+    return NULL;
+}
+
+TEST(evdsptc_test_group, strand_destroy_test){
+    evdsptc_context_t ctx;
+    evdsptc_strand_t* strand = (evdsptc_strand_t*)malloc(sizeof(evdsptc_strand_t));
+    evdsptc_event_t* blocking_event;
+    evdsptc_event_t events[3];
+    pthread_t th;
+    sem_t* sem;
+    int i;
+
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_create_threadpool(&ctx, NULL, NULL, NULL, 1));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_strand_init(strand, &ctx));
+    init_sem_event(&blocking_event, handle_sem_event, &sem, false);
+    mock().expectOneCall("handle_sem_event").onObject(blocking_event);
+    post(&ctx, blocking_event, false);
+    i = 0;
+    while(sem_event_handled_count < 1 && i++ < USLEEP_TIMES) usleep(NUM_OF_USLEEP);
+
+    // the strand event is queued behind the blocking event while the strand is destroyed.
+    for(i = 0; i < 3; i++){
+        evdsptc_event_init(&events[i], handle_inc_event, NULL, false, NULL);
+        CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_strand_post(strand, &events[i]));
+    }
+    pthread_create(&th, NULL, release_sem_routine, sem);
+    evdsptc_strand_destroy(strand);
+    free(strand);
+    pthread_join(th, NULL);
+    for(i = 0; i < 3; i++) CHECK_EQUAL(EVDSPTC_ERROR_CANCELED, evdsptc_event_waitdone(&events[i]));
+    CHECK_EQUAL(0, inc_event_count);
+
+    evdsptc_destroy(&ctx, true);
+    free(sem);
+    free(blocking_event);
+}
+
+#define LOCKFREE_PRODUCERS (4)
+#define LOCKFREE_EVENTS (1000)
+
+static volatile long lockfree_last_seq[LOCKFREE_PRODUCERS];
+static volatile int lockfree_out_of_order = 0;
+
+static bool handle_ordered_event(evdsptc_event_t *event){
+    long param = (long)evdsptc_event_getparam(event);
+    int producer = (int)(param / LOCKFREE_EVENTS);
+    long seq = param % LOCKFREE_EVENTS;
+    if(lockfree_last_seq[producer] + 1 != seq) lockfree_out_of_order++;
+    lockfree_last_seq[producer] = seq;
+    inc_event_count++;
+    return true;
+}
+
+static void* lockfree_produce_routine (void* arg){
+    evdsptc_event_t* events = (evdsptc_event_t*)arg;
+    int i;
+    for(i = 0; i < LOCKFREE_EVENTS; i++){
+        evdsptc_post(events[i].context, &events[i]);
+    }
+    return NULL;
+}
+
+TEST(evdsptc_test_group, lockfree_post_test){
+    evdsptc_context_t ctx;
+    evdsptc_event_t* events[LOCKFREE_PRODUCERS];
+    pthread_t th[LOCKFREE_PRODUCERS];
+    sem_t* sem;
+    evdsptc_event_t* timed;
+    struct timespec intv = {0, TIMER_INTERVAL_NS};
+    int i, j;
+
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_create_lockfree(&ctx, NULL, NULL, NULL));
+
+    init_timed_sem_event(&timed, handle_sem_event, &sem, false, &intv, EVDSPTC_TIMERTYPE_RELATIVE);
+    mock().expectOneCall("handle_sem_event").onObject(timed);
+    sem_post(sem);
+    post(&ctx, timed, false);
+
+    for(i = 0; i < LOCKFREE_PRODUCERS; i++){
+        lockfree_last_seq[i] = -1;
+        events[i] = (evdsptc_event_t*)malloc(sizeof(evdsptc_event_t) * LOCKFREE_EVENTS);
+        for(j = 0; j < LOCKFREE_EVENTS; j++){
+            evdsptc_event_init(&events[i][j], handle_ordered_event, (void*)(long)(i * LOCKFREE_EVENTS + j), false, NULL);
+            events[i][j].context = &ctx;
+        }
+    }
+    for(i = 0; i < LOCKFREE_PRODUCERS; i++) pthread_create(&th[i], NULL, lockfree_produce_routine, (void*)events[i]);
+    for(i = 0; i < LOCKFREE_PRODUCERS; i++) pthread_join(th[i], NULL);
+
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&events[LOCKFREE_PRODUCERS - 1][LOCKFREE_EVENTS - 1]));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(timed));
+    i = 0;
+    while(inc_event_count < LOCKFREE_PRODUCERS * LOCKFREE_EVENTS && i++ < USLEEP_TIMES) usleep(NUM_OF_USLEEP);
+    CHECK_EQUAL(LOCKFREE_PRODUCERS * LOCKFREE_EVENTS, inc_event_count);
+    CHECK_EQUAL(0, lockfree_out_of_order);
+
+    evdsptc_destroy(&ctx, true);
+
+    evdsptc_event_init(&events[0][0], handle_ordered_event, NULL, false, NULL);
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_post(&ctx, &events[0][0]));
+    CHECK_EQUAL(EVDSPTC_ERROR_CANCELED, evdsptc_event_waitdone(&events[0][0]));
+
+    for(i = 0; i < LOCKFREE_PRODUCERS; i++) free(events[i]);
+    free(sem);
+    free(timed);
+}
+
+#define WORKSTEALING_THREADS (4)
+#define WORKSTEALING_CHILDREN (8)
+
+static pthread_t workstealing_threads[WORKSTEALING_CHILDREN];
+static evdsptc_event_t workstealing_children[WORKSTEALING_CHILDREN];
+static long workstealing_order[WORKSTEALING_CHILDREN];
+static volatile int workstealing_handled = 0;
+
+static bool handle_stolen_event(evdsptc_event_t *event){
+    long i = (long)evdsptc_event_getparam(event);
+    workstealing_threads[i] = pthread_self();
+    workstealing_order[__sync_fetch_and_add(&workstealing_handled, 1)] = i;
+    usleep(10 * 1000);
+    __sync_fetch_and_add(&inc_event_count, 1);
+    return true;
+}
+
+static bool handle_fork_event(evdsptc_event_t *event){
+    long i;
+    for(i = 0; i < WORKSTEALING_CHILDREN; i++){
+        evdsptc_event_init(&workstealing_children[i], handle_stolen_event, (void*)i, false, NULL);
+        evdsptc_post(event->context, &workstealing_children[i]);
+    }
+    return true;
+}
+
+TEST(evdsptc_test_group, workstealing_test){
+    evdsptc_context_t ctx;
+    evdsptc_event_t parent;
+    int i, j;
+    int stolen = 0;
+
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_create_workstealing(&ctx, NULL, NULL, NULL, WORKSTEALING_THREADS));
+
+    evdsptc_event_init(&parent, handle_fork_event, NULL, false, NULL);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, post(&ctx, &parent, true));
+    for(i = 0; i < WORKSTEALING_CHILDREN; i++){
+        CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&workstealing_children[i]));
+    }
+    CHECK_EQUAL(WORKSTEALING_CHILDREN, inc_event_count);
+    POINTERS_EQUAL(NULL, ctx.list.root.next);
+    for(i = 0; i < WORKSTEALING_THREADS; i++) POINTERS_EQUAL(NULL, ctx.workers[i].deque.root.next);
+
+    for(i = 1; i < WORKSTEALING_CHILDREN; i++){
+        for(j = 0; j < i && !pthread_equal(workstealing_threads[i], workstealing_threads[j]); j++) continue;
+        if(j == i) stolen++;
+    }
+    CHECK(stolen > 0);
+
+    evdsptc_destroy(&ctx, true);
+}
+
+TEST(evdsptc_test_group, workstealing_order_test){
+    evdsptc_context_t ctx;
+    evdsptc_event_t parent;
+    int i;
+
+    // the owner handles its own deque in posted order.
+    workstealing_handled = 0;
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_create_workstealing(&ctx, NULL, NULL, NULL, 1));
+    evdsptc_event_init(&parent, handle_fork_event, NULL, false, NULL);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, post(&ctx, &parent, true));
+    for(i = 0; i < WORKSTEALING_CHILDREN; i++){
+        CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&workstealing_children[i]));
+    }
+    CHECK_EQUAL(WORKSTEALING_CHILDREN, workstealing_handled);
+    for(i = 0; i < WORKSTEALING_CHILDREN; i++) CHECK_EQUAL(i, workstealing_order[i]);
+
+    evdsptc_destroy(&ctx, true);
+}
+
+static bool handle_self_event(evdsptc_event_t *event){
+    pthread_t* self = (pthread_t*)evdsptc_event_getparam(event);
+    *self = pthread_self();
+    return true;
+}
+
+TEST(evdsptc_test_group, threadpool_wakeup_test){
+    evdsptc_context_t ctx;
+    sem_t* sem;
+    evdsptc_event_t* blocking_event;
+    evdsptc_event_t event[2];
+    pthread_t self[2];
+    int i;
+
+    evdsptc_create_threadpool(&ctx, NULL, NULL, NULL, 4);
+    i = 0;
+    while(ctx.idle_num < 4 && i++ < USLEEP_TIMES) usleep(NUM_OF_USLEEP);
+    CHECK_EQUAL(4, ctx.idle_num);
+
+    evdsptc_event_init(&event[0], handle_self_event, (void*)&self[0], false, NULL);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, post(&ctx, &event[0], true));
+    i = 0;
+    while(ctx.idle_num < 4 && i++ < USLEEP_TIMES) usleep(NUM_OF_USLEEP);
+
+    evdsptc_event_init(&event[1], handle_self_event, (void*)&self[1], false, NULL);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, post(&ctx, &event[1], true));
+    CHECK(pthread_equal(self[0], self[1]));
+
+    init_sem_event(&blocking_event, handle_sem_event, &sem, false);
+    mock().expectOneCall("handle_sem_event").onObject(blocking_event);
+    i = 0;
+    while(ctx.idle_num < 4 && i++ < USLEEP_TIMES) usleep(NUM_OF_USLEEP);
+    post(&ctx, blocking_event, false);
+    i = 0;
+    while(sem_event_handled_count < 1 && i++ < USLEEP_TIMES) usleep(NUM_OF_USLEEP);
+    usleep(USLEEP_TIMES);
+    CHECK_EQUAL(3, ctx.idle_num);
+
+    sem_post(sem);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(blocking_event));
+    evdsptc_destroy(&ctx, true);
+
+    free(sem);
+    free(blocking_event);
+}
+
+#define WHEEL_TIMERS (200)
+
+static volatile int timer_early_count = 0;
+
+static bool handle_timer_check_event(evdsptc_event_t *event){
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    if(evdsptc_timespec_compare(&event->timer, &now) > 0) timer_early_count++;
+    __sync_fetch_and_add(&inc_event_count, 1);
+    return true;
+}
+
+TEST(evdsptc_test_group, timer_wheel_test){
+    evdsptc_context_t ctx;
+    evdsptc_event_t* event;
+    struct timespec resolution = {0, 10 * 1000};
+    struct timespec timer;
+    int i;
+
+    timer_early_count = 0;
+    event = (evdsptc_event_t*)malloc(sizeof(evdsptc_event_t) * WHEEL_TIMERS);
+    evdsptc_create(&ctx, NULL, NULL, NULL);
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_settimerbackend(&ctx, EVDSPTC_TIMERBACKEND_WHEEL, NULL));
+
+    for(i = 0; i < WHEEL_TIMERS / 2; i++){
+        timer.tv_sec = 0;
+        timer.tv_nsec = (rand() % 100) * 1000 * 1000;
+        evdsptc_event_init(&event[i], handle_timer_check_event, NULL, false, NULL);
+        evdsptc_event_settimer(&event[i], &timer, EVDSPTC_TIMERTYPE_RELATIVE);
+        evdsptc_post(&ctx, &event[i]);
+    }
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_settimerbackend(&ctx, EVDSPTC_TIMERBACKEND_WHEEL, &resolution));
+    POINTERS_EQUAL(NULL, ctx.timer_list.root.next);
+
+    for(; i < WHEEL_TIMERS; i++){
+        evdsptc_event_init(&event[i], handle_timer_check_event, NULL, false, NULL);
+        clock_gettime(CLOCK_REALTIME, &timer);
+        timer.tv_nsec = (timer.tv_nsec / 1000) * 1000 + 123;
+        timer.tv_sec += (i % 2);
+        evdsptc_event_settimer(&event[i], &timer, EVDSPTC_TIMERTYPE_ABSOLUTE);
+        evdsptc_post(&ctx, &event[i]);
+    }
+
+    for(i = 0; i < WHEEL_TIMERS; i++){
+        CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&event[i]));
+    }
+    CHECK_EQUAL(WHEEL_TIMERS, inc_event_count);
+    CHECK_EQUAL(0, timer_early_count);
+    CHECK_EQUAL(0, ctx.timer_num);
+
+    evdsptc_destroy(&ctx, true);
+    free(event);
+}
+
+static void timer_cancel_check(evdsptc_timerbackend_t backend){
+    evdsptc_context_t ctx;
+    evdsptc_event_t event[3];
+    struct timespec resolution = {0, 1000 * 1000};
+    struct timespec timer = {10, 0};
+    struct timespec soon = {0, 1000 * 1000};
+    int i;
+
+    timer_early_count = 0;
+    evdsptc_create(&ctx, NULL, NULL, NULL);
+    evdsptc_settimerbackend(&ctx, backend, &resolution);
+    for(i = 0; i < 3; i++){
+        evdsptc_event_init(&event[i], handle_timer_check_event, NULL, false, NULL);
+        evdsptc_event_settimer(&event[i], &timer, EVDSPTC_TIMERTYPE_RELATIVE);
+        CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_post(&ctx, &event[i]));
+    }
+    CHECK_EQUAL(3, ctx.timer_num);
+
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_timer_cancel(&ctx, &event[0]));
+    CHECK_EQUAL(EVDSPTC_ERROR_CANCELED, evdsptc_event_waitdone(&event[0]));
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_timer_cancel(&ctx, &event[0]));
+    CHECK_EQUAL(2, ctx.timer_num);
+
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_event_reschedule(&ctx, &event[1], &soon, EVDSPTC_TIMERTYPE_IMMEDIATE));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_reschedule(&ctx, &event[1], &soon, EVDSPTC_TIMERTYPE_RELATIVE));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&event[1]));
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_event_reschedule(&ctx, &event[1], &soon, EVDSPTC_TIMERTYPE_RELATIVE));
+    CHECK_EQUAL(1, ctx.timer_num);
+
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_timer_cancel(&ctx, &event[2]));
+    CHECK_EQUAL(EVDSPTC_ERROR_CANCELED, evdsptc_event_waitdone(&event[2]));
+    CHECK_EQUAL(0, ctx.timer_num);
+    CHECK_EQUAL(1, inc_event_count);
+    CHECK_EQUAL(0, timer_early_count);
+    if(backend == EVDSPTC_TIMERBACKEND_WHEEL){
+        for(i = 0; i < EVDSPTC_WHEEL_LEVELS; i++) CHECK_EQUAL(0, ctx.timer_wheel->bitmap[i]);
+    }else POINTERS_EQUAL(NULL, ctx.timer_list.root.next);
+
+    evdsptc_destroy(&ctx, true);
+}
+
+TEST(evdsptc_test_group, timer_cancel_test){
+    timer_cancel_check(EVDSPTC_TIMERBACKEND_LIST);
+    inc_event_count = 0;
+    timer_cancel_check(EVDSPTC_TIMERBACKEND_WHEEL);
+    inc_event_count = 0;
+    timer_cancel_check(EVDSPTC_TIMERBACKEND_TIMERFD);
+}
+
+#define TIMERFD_TIMERS (100)
+
+static struct timespec timerfd_due[TIMERFD_TIMERS];
+
+static bool handle_timerfd_event(evdsptc_event_t *event){
+    struct timespec now;
+    clock_gettime(event->timertype == EVDSPTC_TIMERTYPE_RELATIVE ? CLOCK_MONOTONIC : CLOCK_REALTIME, &now);
+    if(evdsptc_timespec_compare(&timerfd_due[(long)evdsptc_event_getparam(event)], &now) > 0) timer_early_count++;
+    __sync_fetch_and_add(&inc_event_count, 1);
+    return true;
+}
+
+static void timerfd_check(evdsptc_context_t* ctx){
+    evdsptc_event_t* event;
+    struct timespec timer;
+    struct timespec now;
+    int i;
+
+    timer_early_count = 0;
+    inc_event_count = 0;
+    event = (evdsptc_event_t*)malloc(sizeof(evdsptc_event_t) * TIMERFD_TIMERS);
+
+    // relative timers posted before the backend is selected are moved onto CLOCK_MONOTONIC.
+    for(i = 0; i < TIMERFD_TIMERS / 2; i++){
+        timer.tv_sec = 0;
+        timer.tv_nsec = (rand() % 50) * 1000 * 1000;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        timerfd_due[i] = evdsptc_timespec_add(&now, &timer);
+        evdsptc_event_init(&event[i], handle_timerfd_event, (void*)(long)i, false, NULL);
+        evdsptc_event_settimer(&event[i], &timer, EVDSPTC_TIMERTYPE_RELATIVE);
+        evdsptc_post(ctx, &event[i]);
+    }
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_settimerbackend(ctx, EVDSPTC_TIMERBACKEND_TIMERFD, NULL));
+    POINTERS_EQUAL(NULL, ctx->timer_list.root.next);
+
+    // absolute timers stay on CLOCK_REALTIME.
+    for(; i < TIMERFD_TIMERS; i++){
+        timer.tv_sec = 0;
+        timer.tv_nsec = (rand() % 50) * 1000 * 1000;
+        evdsptc_event_init(&event[i], handle_timerfd_event, (void*)(long)i, false, NULL);
+        if(i % 2){
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            timerfd_due[i] = evdsptc_timespec_add(&now, &timer);
+            evdsptc_event_settimer(&event[i], &timer, EVDSPTC_TIMERTYPE_RELATIVE);
+        }else{
+            clock_gettime(CLOCK_REALTIME, &now);
+            timerfd_due[i] = evdsptc_timespec_add(&now, &timer);
+            evdsptc_event_settimer(&event[i], &timerfd_due[i], EVDSPTC_TIMERTYPE_ABSOLUTE);
+        }
+        evdsptc_post(ctx, &event[i]);
+    }
+
+    for(i = 0; i < TIMERFD_TIMERS; i++){
+        CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&event[i]));
+    }
+    CHECK_EQUAL(TIMERFD_TIMERS, inc_event_count);
+    CHECK_EQUAL(0, timer_early_count);
+    CHECK_EQUAL(0, ctx->timer_num);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_settimerbackend(ctx, EVDSPTC_TIMERBACKEND_LIST, NULL));
+    free(event);
+}
+
+TEST(evdsptc_test_group, timerfd_test){
+    evdsptc_context_t ctx;
+
+    evdsptc_create_threadpool(&ctx, NULL, NULL, NULL, 4);
+    timerfd_check(&ctx);
+    evdsptc_destroy(&ctx, true);
+}
+
+// the lockfree and workstealing threads look for timers without the lock, so a wakeup of the timer thread
+// must not get lost before it parks.
+TEST(evdsptc_test_group, timerfd_lockfree_test){
+    evdsptc_context_t ctx;
+    int i;
+
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_create_lockfree(&ctx, NULL, NULL, NULL));
+    for(i = 0; i < 4; i++) timerfd_check(&ctx);
+    evdsptc_destroy(&ctx, true);
+}
+
+TEST(evdsptc_test_group, timerfd_workstealing_test){
+    evdsptc_context_t ctx;
+    int i;
+
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_create_workstealing(&ctx, NULL, NULL, NULL, 2));
+    for(i = 0; i < 4; i++) timerfd_check(&ctx);
+    evdsptc_destroy(&ctx, true);
+}
+
+#define BATCH_EVENTS (64)
+
+static volatile int batch_timer_order[BATCH_EVENTS];
+static volatile int batch_timer_handled = 0;
+
+static bool handle_batch_timer_event(evdsptc_event_t *event){
+    batch_timer_order[batch_timer_handled++] = (int)(long)evdsptc_event_getparam(event);
+    return true;
+}
+
+static void post_batch_check(evdsptc_context_t* ctx){
+    evdsptc_event_t events[BATCH_EVENTS * 2];
+    evdsptc_event_t* batch[BATCH_EVENTS * 2];
+    struct timespec timer;
+    int i;
+
+    inc_event_count = 0;
+    batch_timer_handled = 0;
+    lockfree_last_seq[0] = -1;
+    lockfree_out_of_order = 0;
+    for(i = 0; i < BATCH_EVENTS; i++){
+        evdsptc_event_init(&events[i * 2], handle_ordered_event, (void*)(long)i, false, NULL);
+        evdsptc_event_init(&events[i * 2 + 1], handle_batch_timer_event, (void*)(long)i, false, NULL);
+        timer.tv_sec = 0;
+        timer.tv_nsec = (BATCH_EVENTS - i + (i % 2) * BATCH_EVENTS) * 1000 * 1000;
+        evdsptc_event_settimer(&events[i * 2 + 1], &timer, EVDSPTC_TIMERTYPE_RELATIVE);
+    }
+    for(i = 0; i < BATCH_EVENTS * 2; i++) batch[i] = &events[i];
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_post(ctx, batch[1]));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_post_batch(ctx, batch, 1));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_post_batch(ctx, &batch[2], BATCH_EVENTS * 2 - 2));
+
+    for(i = 0; i < BATCH_EVENTS * 2; i++) CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&events[i]));
+    CHECK_EQUAL(BATCH_EVENTS, inc_event_count);
+    CHECK_EQUAL(0, lockfree_out_of_order);
+    CHECK_EQUAL(BATCH_EVENTS, batch_timer_handled);
+    for(i = 0; i < BATCH_EVENTS / 2; i++){
+        CHECK_EQUAL(BATCH_EVENTS - 2 - i * 2, batch_timer_order[i]);
+        CHECK_EQUAL(BATCH_EVENTS - 1 - i * 2, batch_timer_order[BATCH_EVENTS / 2 + i]);
+    }
+}
+
+TEST(evdsptc_test_group, post_batch_test){
+    evdsptc_context_t ctx;
+    evdsptc_event_t events[2];
+    evdsptc_list_t list;
+    struct timespec timer = {0, 1000 * 1000};
+
+    evdsptc_create(&ctx, NULL, NULL, NULL);
+    post_batch_check(&ctx);
+    evdsptc_destroy(&ctx, true);
+
+    evdsptc_create_lockfree(&ctx, NULL, NULL, NULL);
+    post_batch_check(&ctx);
+    evdsptc_destroy(&ctx, true);
+
+    evdsptc_list_init(&list);
+    evdsptc_event_init(&events[0], handle_ordered_event, NULL, false, NULL);
+    evdsptc_event_init(&events[1], handle_ordered_event, NULL, false, NULL);
+    evdsptc_event_settimer(&events[1], &timer, EVDSPTC_TIMERTYPE_RELATIVE);
+    evdsptc_list_push(&list, &events[0].listelem);
+    evdsptc_list_push(&list, &events[1].listelem);
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_post_list(&ctx, &list));
+    CHECK(evdsptc_list_isempty(&list));
+    CHECK_EQUAL(EVDSPTC_ERROR_CANCELED, evdsptc_event_waitdone(&events[0]));
+    CHECK_EQUAL(EVDSPTC_ERROR_CANCELED, evdsptc_event_waitdone(&events[1]));
+}
+
+#define BATCH_SIZE (16)
+
+static volatile int batch_handler_calls = 0;
+static volatile int batch_handler_max = 0;
+
+static bool handle_batch_event(evdsptc_event_t** events, int n){
+    int i;
+    for(i = 0; i < n; i++) CHECK(events[i]->batch_handler == handle_batch_event);
+    if(batch_handler_max < n) batch_handler_max = n;
+    batch_handler_calls++;
+    inc_event_count += n;
+    return true;
+}
+
+TEST(evdsptc_test_group, batch_handler_test){
+    evdsptc_context_t ctx;
+    evdsptc_event_t* blocking_event;
+    evdsptc_event_t events[BATCH_SIZE * 2];
+    evdsptc_event_t* batch[BATCH_SIZE * 2];
+    sem_t* sem;
+    int i;
+
+    batch_handler_calls = 0;
+    batch_handler_max = 0;
+    evdsptc_create_workstealing(&ctx, NULL, NULL, NULL, 2);
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_setbatchsize(&ctx, BATCH_SIZE));
+    evdsptc_destroy(&ctx, true);
+
+    evdsptc_create(&ctx, NULL, NULL, NULL);
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_setbatchsize(&ctx, 0));
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_setbatchsize(&ctx, EVDSPTC_MAX_BATCH_SIZE + 1));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_setbatchsize(&ctx, BATCH_SIZE));
+
+    init_sem_event(&blocking_event, handle_sem_event, &sem, false);
+    mock().expectOneCall("handle_sem_event").onObject(blocking_event);
+    post(&ctx, blocking_event, false);
+    i = 0;
+    while(sem_event_handled_count < 1 && i++ < USLEEP_TIMES) usleep(NUM_OF_USLEEP);
+    for(i = 0; i < BATCH_SIZE * 2; i++){
+        evdsptc_event_init(&events[i], NULL, NULL, false, NULL);
+        evdsptc_event_setbatchhandler(&events[i], handle_batch_event);
+        batch[i] = &events[i];
+    }
+    evdsptc_post_batch(&ctx, batch, BATCH_SIZE * 2);
+    sem_post(sem);
+
+    for(i = 0; i < BATCH_SIZE * 2; i++) CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&events[i]));
+    CHECK_EQUAL(BATCH_SIZE * 2, inc_event_count);
+    CHECK_EQUAL(BATCH_SIZE, batch_handler_max);
+    CHECK_EQUAL(2, batch_handler_calls);
+
+    evdsptc_destroy(&ctx, true);
+    free(sem);
+    free(blocking_event);
+}
+
+#define COMPLETION_WAITERS (3)
+
+static void* completion_wait_routine(void* arg){
+    return (void*)(long)evdsptc_event_waitdone((evdsptc_event_t*)arg);
+}
+
+TEST(evdsptc_test_group, completion_test){
+    evdsptc_context_t ctx;
+    evdsptc_event_t* blocking_event;
+    evdsptc_event_t event;
+    pthread_t th[COMPLETION_WAITERS];
+    sem_t* sem;
+    void* ret;
+    int i, j;
+
+    evdsptc_create(&ctx, NULL, NULL, NULL);
+    init_sem_event(&blocking_event, handle_sem_event, &sem, false);
+    evdsptc_event_init(&event, NULL, NULL, false, NULL);
+    mock().expectNCalls(2, "handle_sem_event").onObject(blocking_event);
+
+    for(j = 0; j < 2; j++){
+        post(&ctx, blocking_event, false);
+        CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_post(&ctx, &event));
+        CHECK_EQUAL(EVDSPTC_ERROR_NOT_DONE, evdsptc_event_trywaitdone(&event));
+        for(i = 0; i < COMPLETION_WAITERS; i++) pthread_create(&th[i], NULL, completion_wait_routine, (void*)&event);
+        usleep(10 * 1000);
+        sem_post(sem);
+        for(i = 0; i < COMPLETION_WAITERS; i++){
+            pthread_join(th[i], &ret);
+            CHECK_EQUAL(EVDSPTC_ERROR_NONE, (evdsptc_error_t)(long)ret);
+        }
+        CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_trywaitdone(&event));
+        CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&event));
+        CHECK(evdsptc_event_isdone(&event));
+    }
+
+    evdsptc_destroy(&ctx, true);
+    free(sem);
+    free(blocking_event);
+}
+
+#define POOL_CAPACITY (40)
+
+static bool handle_pooled_event(evdsptc_event_t *event){
+    (void)event;
+    __sync_fetch_and_add(&inc_event_count, 1);
+    return true;
+}
+
+TEST(evdsptc_test_group, eventpool_test){
+    evdsptc_context_t ctx;
+    evdsptc_eventpool_t pool;
+    evdsptc_event_t* events[POOL_CAPACITY + 1];
+    int i, j;
+
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_eventpool_create(&pool, 0));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_eventpool_create(&pool, POOL_CAPACITY));
+    evdsptc_create_threadpool(&ctx, NULL, NULL, NULL, 2);
+
+    for(j = 0; j < 3; j++){
+        for(i = 0; i < POOL_CAPACITY; i++){
+            CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_eventpool_alloc(&pool, &events[i], handle_pooled_event, NULL));
+        }
+        CHECK_EQUAL(EVDSPTC_ERROR_POOL_EXHAUSTED, evdsptc_eventpool_alloc(&pool, &events[POOL_CAPACITY], handle_pooled_event, NULL));
+        POINTERS_EQUAL(NULL, events[POOL_CAPACITY]);
+        CHECK_EQUAL(j + 1, (int)pool.exhausted_count);
+
+        inc_event_count = 0;
+        CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_post_batch(&ctx, events, POOL_CAPACITY));
+        i = 0;
+        while(inc_event_count < POOL_CAPACITY && i++ < USLEEP_TIMES) usleep(NUM_OF_USLEEP);
+        CHECK_EQUAL(POOL_CAPACITY, inc_event_count);
+        usleep(10 * 1000);
+    }
+    evdsptc_destroy(&ctx, true);
+
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_eventpool_alloc(&pool, &events[0], handle_pooled_event, NULL));
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_post(&ctx, events[0]));
+    for(i = 0; i < POOL_CAPACITY; i++){
+        CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_eventpool_alloc(&pool, &events[i], handle_pooled_event, NULL));
+    }
+    CHECK_EQUAL(EVDSPTC_ERROR_NOT_DONE, evdsptc_eventpool_destroy(&pool));
+    for(i = 0; i < POOL_CAPACITY; i++) evdsptc_eventpool_free(events[i]);
+
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_eventpool_destroy(&pool));
+}
+
+#define PRIORITY_EVENTS (9)
+
+static volatile int priority_order[PRIORITY_EVENTS];
+static volatile int priority_handled = 0;
+
+static bool handle_priority_event(evdsptc_event_t *event){
+    priority_order[priority_handled++] = (int)(long)evdsptc_event_getparam(event);
+    return true;
+}
+
+static void priority_check(evdsptc_context_t* ctx, struct timespec* aging){
+    evdsptc_event_t* blocking_event;
+    evdsptc_event_t events[PRIORITY_EVENTS];
+    int priorities[] = {0, 5, EVDSPTC_PRIORITY_LEVELS - 1};
+    sem_t* sem;
+    int i;
+
+    priority_handled = 0;
+    sem_event_handled_count = 0;
+    if(aging != NULL) CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_setpriorityaging(ctx, aging));
+    init_sem_event(&blocking_event, handle_sem_event, &sem, false);
+    evdsptc_event_setpriority(blocking_event, EVDSPTC_PRIORITY_LEVELS);
+    CHECK_EQUAL(EVDSPTC_PRIORITY_LEVELS - 1, blocking_event->priority);
+    mock().expectOneCall("handle_sem_event").onObject(blocking_event);
+    post(ctx, blocking_event, false);
+    i = 0;
+    while(sem_event_handled_count < 1 && i++ < USLEEP_TIMES) usleep(NUM_OF_USLEEP);
+
+    for(i = 0; i < PRIORITY_EVENTS; i++){
+        evdsptc_event_init(&events[i], handle_priority_event, (void*)(long)i, false, NULL);
+        evdsptc_event_setpriority(&events[i], priorities[i % 3]);
+        evdsptc_post(ctx, &events[i]);
+        if(i == 0 && aging != NULL) usleep(10 * 1000);
+    }
+    sem_post(sem);
+    for(i = 0; i < PRIORITY_EVENTS; i++) CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&events[i]));
+
+    if(aging != NULL){
+        CHECK_EQUAL(0, priority_order[0]);
+        CHECK_EQUAL(2, priority_order[1]);
+    }else{
+        int expected[] = {2, 5, 8, 1, 4, 7, 0, 3, 6};
+        for(i = 0; i < PRIORITY_EVENTS; i++) CHECK_EQUAL(expected[i], priority_order[i]);
+    }
+    free(sem);
+    free(blocking_event);
+}
+
+TEST(evdsptc_test_group, priority_test){
+    evdsptc_context_t ctx;
+    struct timespec aging = {0, 5 * 1000 * 1000};
+
+    evdsptc_create(&ctx, NULL, NULL, NULL);
+    priority_check(&ctx, NULL);
+    priority_check(&ctx, &aging);
+    evdsptc_destroy(&ctx, true);
+
+    evdsptc_create_lockfree(&ctx, NULL, NULL, NULL);
+    priority_check(&ctx, NULL);
+    evdsptc_destroy(&ctx, true);
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_setpriorityaging(&ctx, &aging));
+}
+
+TEST(evdsptc_test_group, edf_test){
+    evdsptc_context_t ctx;
+    evdsptc_event_t* blocking_event;
+    evdsptc_event_t events[7];
+    long deadlines_ms[] = {300, 100, 0, 200, -1000};
+    int expected[] = {4, 1, 3, 0, 2};
+    struct timespec deadline;
+    struct timespec aging = {0, 20 * 1000 * 1000};
+    sem_t* sem;
+    int i, j;
+
+    evdsptc_create_lockfree(&ctx, NULL, NULL, NULL);
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_setschedpolicy(&ctx, EVDSPTC_SCHEDPOLICY_EDF, false));
+    evdsptc_destroy(&ctx, true);
+
+    evdsptc_create(&ctx, NULL, NULL, NULL);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_setschedpolicy(&ctx, EVDSPTC_SCHEDPOLICY_EDF, false));
+    init_sem_event(&blocking_event, handle_sem_event, &sem, false);
+    mock().expectNCalls(3, "handle_sem_event").onObject(blocking_event);
+
+    priority_handled = 0;
+    sem_event_handled_count = 0;
+    post(&ctx, blocking_event, false);
+    i = 0;
+    while(sem_event_handled_count < 1 && i++ < USLEEP_TIMES) usleep(NUM_OF_USLEEP);
+    for(i = 0; i < 5; i++){
+        evdsptc_event_init(&events[i], handle_priority_event, (void*)(long)i, false, NULL);
+        if(deadlines_ms[i] > 0){
+            deadline.tv_sec = 0;
+            deadline.tv_nsec = deadlines_ms[i] * 1000 * 1000;
+            evdsptc_event_setdeadline(&events[i], &deadline, EVDSPTC_TIMERTYPE_RELATIVE);
+        }else if(deadlines_ms[i] < 0){
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec -= 1;
+            evdsptc_event_setdeadline(&events[i], &deadline, EVDSPTC_TIMERTYPE_ABSOLUTE);
+        }
+        evdsptc_post(&ctx, &events[i]);
+    }
+    sem_post(sem);
+    for(i = 0; i < 5; i++) CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&events[i]));
+    for(i = 0; i < 5; i++) CHECK_EQUAL(expected[i], priority_order[i]);
+    CHECK_EQUAL(1, (int)evdsptc_getdeadlinemisscount(&ctx));
+
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_setschedpolicy(&ctx, EVDSPTC_SCHEDPOLICY_EDF, true));
+    sem_event_handled_count = 0;
+    post(&ctx, blocking_event, false);
+    j = 0;
+    while(sem_event_handled_count < 1 && j++ < USLEEP_TIMES) usleep(NUM_OF_USLEEP);
+    evdsptc_event_init(&events[5], handle_priority_event, (void*)5L, false, NULL);
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec -= 1;
+    evdsptc_event_setdeadline(&events[5], &deadline, EVDSPTC_TIMERTYPE_ABSOLUTE);
+    evdsptc_post(&ctx, &events[5]);
+    evdsptc_event_init(&events[6], handle_priority_event, (void*)6L, false, NULL);
+    deadline.tv_sec = 1;
+    deadline.tv_nsec = 0;
+    evdsptc_event_setdeadline(&events[6], &deadline, EVDSPTC_TIMERTYPE_RELATIVE);
+    evdsptc_post(&ctx, &events[6]);
+    sem_post(sem);
+    CHECK_EQUAL(EVDSPTC_ERROR_CANCELED, evdsptc_event_waitdone(&events[5]));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&events[6]));
+    CHECK_EQUAL(6, priority_handled);
+    CHECK_EQUAL(2, (int)evdsptc_getdeadlinemisscount(&ctx));
+
+    // with the aging, an event without deadline is due after the aging, and never missed.
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_setpriorityaging(&ctx, &aging));
+    sem_event_handled_count = 0;
+    post(&ctx, blocking_event, false);
+    j = 0;
+    while(sem_event_handled_count < 1 && j++ < USLEEP_TIMES) usleep(NUM_OF_USLEEP);
+    evdsptc_event_init(&events[5], handle_priority_event, (void*)5L, false, NULL);
+    deadline.tv_sec = 1;
+    deadline.tv_nsec = 0;
+    evdsptc_event_setdeadline(&events[5], &deadline, EVDSPTC_TIMERTYPE_RELATIVE);
+    evdsptc_post(&ctx, &events[5]);
+    evdsptc_event_init(&events[6], handle_priority_event, (void*)6L, false, NULL);
+    evdsptc_post(&ctx, &events[6]);
+    usleep(40 * 1000);
+    sem_post(sem);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&events[5]));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&events[6]));
+    CHECK_EQUAL(8, priority_handled);
+    CHECK_EQUAL(6, priority_order[6]);
+    CHECK_EQUAL(5, priority_order[7]);
+    CHECK_EQUAL(2, (int)evdsptc_getdeadlinemisscount(&ctx));
+
+    // the relative deadline is kept, so a reposted event counts it from the new posting.
+    priority_handled = 0;
+    evdsptc_event_init(&events[0], handle_priority_event, (void*)0L, false, NULL);
+    deadline.tv_sec = 0;
+    deadline.tv_nsec = 20 * 1000 * 1000;
+    evdsptc_event_setdeadline(&events[0], &deadline, EVDSPTC_TIMERTYPE_RELATIVE);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_post(&ctx, &events[0]));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&events[0]));
+    CHECK_EQUAL(EVDSPTC_TIMERTYPE_RELATIVE, events[0].deadlinetype);
+    CHECK_EQUAL(0, (int)events[0].deadline.tv_sec);
+    CHECK_EQUAL(20 * 1000 * 1000, events[0].deadline.tv_nsec);
+    usleep(40 * 1000);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_post(&ctx, &events[0]));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&events[0]));
+    CHECK_EQUAL(2, priority_handled);
+    CHECK_EQUAL(2, (int)evdsptc_getdeadlinemisscount(&ctx));
+
+    evdsptc_destroy(&ctx, true);
+    free(sem);
+    free(blocking_event);
+}
+
+static volatile int coalesce_destructed = 0;
+
+static void destruct_coalesce_event(evdsptc_event_t *event){
+    coalesce_destructed++;
+    free(event);
+}
+
+static evdsptc_event_t* post_coalesce_event(evdsptc_context_t* ctx, long param, unsigned long long int key){
+    evdsptc_event_t* event = (evdsptc_event_t*)malloc(sizeof(evdsptc_event_t));
+    evdsptc_event_init(event, handle_priority_event, (void*)param, true, destruct_coalesce_event);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_post_coalesce(ctx, event, key));
+    return event;
+}
+
+static void coalesce_check(evdsptc_context_t* ctx){
+    evdsptc_event_t* blocking_event;
+    evdsptc_event_t pending;
+    evdsptc_event_t last;
+    sem_t* sem;
+    int i;
+
+    init_sem_event(&blocking_event, handle_sem_event, &sem, false);
+    mock().expectOneCall("handle_sem_event").onObject(blocking_event);
+    priority_handled = 0;
+    sem_event_handled_count = 0;
+    coalesce_destructed = 0;
+    post(ctx, blocking_event, false);
+    i = 0;
+    while(sem_event_handled_count < 1 && i++ < USLEEP_TIMES) usleep(NUM_OF_USLEEP);
+
+    // the latest event replaces the pending one in its place.
+    for(i = 0; i < 100; i++){
+        post_coalesce_event(ctx, 100 + i, 1);
+        post_coalesce_event(ctx, 200 + i, 2);
+    }
+    post_coalesce_event(ctx, 300, 3);
+    // the pending event posted again stays in its place.
+    evdsptc_event_init(&pending, handle_priority_event, (void*)350L, false, NULL);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_post_coalesce(ctx, &pending, 4));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_post_coalesce(ctx, &pending, 4));
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_post_coalesce(ctx, &pending, 5));
+    evdsptc_event_init(&last, handle_priority_event, (void*)400L, false, NULL);
+    evdsptc_post(ctx, &last);
+    CHECK_EQUAL(198, coalesce_destructed);
+
+    sem_post(sem);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&last));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&pending));
+    CHECK_EQUAL(5, priority_handled);
+    CHECK_EQUAL(199, priority_order[0]);
+    CHECK_EQUAL(299, priority_order[1]);
+    CHECK_EQUAL(300, priority_order[2]);
+    CHECK_EQUAL(350, priority_order[3]);
+    CHECK_EQUAL(400, priority_order[4]);
+    CHECK_EQUAL(201, coalesce_destructed);
+
+    // handled events no longer coalesce.
+    post_coalesce_event(ctx, 500, 1);
+    i = 0;
+    while(coalesce_destructed < 202 && i++ < USLEEP_TIMES) usleep(NUM_OF_USLEEP);
+    CHECK_EQUAL(6, priority_handled);
+    CHECK_EQUAL(500, priority_order[5]);
+
+    free(sem);
+    free(blocking_event);
+}
+
+TEST(evdsptc_test_group, coalesce_test){
+    evdsptc_context_t ctx;
+    evdsptc_event_t event;
+    struct timespec timer = {0, 1000};
+
+    evdsptc_create(&ctx, NULL, NULL, NULL);
+    coalesce_check(&ctx);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_setschedpolicy(&ctx, EVDSPTC_SCHEDPOLICY_EDF, false));
+    coalesce_check(&ctx);
+
+    evdsptc_event_init(&event, handle_priority_event, NULL, false, NULL);
+    evdsptc_event_settimer(&event, &timer, EVDSPTC_TIMERTYPE_RELATIVE);
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_post_coalesce(&ctx, &event, 1));
+    evdsptc_destroy(&ctx, true);
+
+    evdsptc_create_lockfree(&ctx, NULL, NULL, NULL);
+    coalesce_check(&ctx);
+    evdsptc_destroy(&ctx, true);
+}
+
+static volatile int high_watermark_count = 0;
+static volatile int low_watermark_count = 0;
+
+static void handle_high_watermark(evdsptc_context_t* context){
+    (void)context;
+    high_watermark_count++;
+}
+
+static void handle_low_watermark(evdsptc_context_t* context){
+    (void)context;
+    low_watermark_count++;
+}
+
+TEST(evdsptc_test_group, bounded_test){
+    evdsptc_context_t ctx;
+    evdsptc_event_t* blocking_event;
+    evdsptc_event_t events[7];
+    struct timespec timeout = {0, 20 * 1000 * 1000};
+    struct timespec begin;
+    struct timespec end;
+    pthread_t th;
+    sem_t* sem;
+    int i;
+
+    evdsptc_create(&ctx, NULL, NULL, NULL);
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_setwatermarks(&ctx, 1, 3, NULL, NULL));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_setcapacity(&ctx, 4));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_setwatermarks(&ctx, 3, 1, handle_high_watermark, handle_low_watermark));
+    high_watermark_count = 0;
+    low_watermark_count = 0;
+
+    init_sem_event(&blocking_event, handle_sem_event, &sem, false);
+    mock().expectOneCall("handle_sem_event").onObject(blocking_event);
+    post(&ctx, blocking_event, false);
+    i = 0;
+    while(sem_event_handled_count < 1 && i++ < USLEEP_TIMES) usleep(NUM_OF_USLEEP);
+    CHECK_EQUAL(0, evdsptc_getqueuednum(&ctx));
+
+    for(i = 0; i < 7; i++) evdsptc_event_init(&events[i], handle_inc_event, NULL, false, NULL);
+    for(i = 0; i < 4; i++) CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_trypost(&ctx, &events[i]));
+    CHECK_EQUAL(4, evdsptc_getqueuednum(&ctx));
+    CHECK_EQUAL(1, high_watermark_count);
+
+    // trypost leaves the event to the caller, post cancels it.
+    CHECK_EQUAL(EVDSPTC_ERROR_FULL, evdsptc_trypost(&ctx, &events[4]));
+    CHECK_FALSE(events[4].is_canceled);
+    CHECK_EQUAL(EVDSPTC_ERROR_FULL, evdsptc_post(&ctx, &events[4]));
+    CHECK(events[4].is_canceled);
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    CHECK_EQUAL(EVDSPTC_ERROR_FULL, evdsptc_timedpost(&ctx, &events[5], &timeout));
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    CHECK(19 * 1000 * 1000 <= (end.tv_sec - begin.tv_sec) * 1000 * 1000 * 1000 + (end.tv_nsec - begin.tv_nsec));
+    CHECK_FALSE(events[5].is_canceled);
+
+    // a blocked post proceeds once the queue drains.
+    pthread_create(&th, NULL, release_sem_routine, sem);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_timedpost(&ctx, &events[5], NULL));
+    pthread_join(th, NULL);
+    for(i = 0; i < 4; i++) CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&events[i]));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&events[5]));
+    CHECK_EQUAL(0, evdsptc_getqueuednum(&ctx));
+    CHECK_EQUAL(1, high_watermark_count);
+    CHECK_EQUAL(1, low_watermark_count);
+
+    // timer events are not counted.
+    evdsptc_event_init(&events[6], handle_inc_event, NULL, false, NULL);
+    evdsptc_event_settimer(&events[6], &timeout, EVDSPTC_TIMERTYPE_RELATIVE);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_trypost(&ctx, &events[6]));
+    CHECK_EQUAL(0, evdsptc_getqueuednum(&ctx));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&events[6]));
+    CHECK_EQUAL(6, inc_event_count);
+
+    evdsptc_destroy(&ctx, true);
+    free(sem);
+    free(blocking_event);
+}
+
+static bool fd_isreadable(int fd, int timeout_ms){
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return 1 == poll(&pfd, 1, timeout_ms) && (pfd.revents & POLLIN);
+}
+
+// the events of a strand hold their room in the queue until they are handled or canceled.
+TEST(evdsptc_test_group, bounded_strand_test){
+    evdsptc_context_t ctx;
+    evdsptc_strand_t strand;
+    evdsptc_event_t* blocking_event;
+    evdsptc_event_t events[3];
+    pthread_t th;
+    sem_t* sem;
+    int i;
+
+    evdsptc_create(&ctx, NULL, NULL, NULL);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_setcapacity(&ctx, 4));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_setwatermarks(&ctx, 3, 1, handle_high_watermark, handle_low_watermark));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_strand_init(&strand, &ctx));
+    high_watermark_count = 0;
+    low_watermark_count = 0;
+
+    init_sem_event(&blocking_event, handle_sem_event, &sem, false);
+    mock().expectOneCall("handle_sem_event").onObject(blocking_event);
+    post(&ctx, blocking_event, false);
+    i = 0;
+    while(sem_event_handled_count < 1 && i++ < USLEEP_TIMES) usleep(NUM_OF_USLEEP);
+
+    for(i = 0; i < 3; i++){
+        evdsptc_event_init(&events[i], handle_inc_event, NULL, false, NULL);
+        CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_strand_post(&strand, &events[i]));
+    }
+    CHECK_EQUAL(3, evdsptc_getqueuednum(&ctx));
+    CHECK_EQUAL(1, high_watermark_count);
+
+    pthread_create(&th, NULL, release_sem_routine, sem);
+    evdsptc_strand_destroy(&strand);
+    pthread_join(th, NULL);
+    for(i = 0; i < 3; i++) CHECK_EQUAL(EVDSPTC_ERROR_CANCELED, evdsptc_event_waitdone(&events[i]));
+    CHECK_EQUAL(0, evdsptc_getqueuednum(&ctx));
+    CHECK_EQUAL(1, low_watermark_count);
+
+    evdsptc_destroy(&ctx, true);
+    free(sem);
+    free(blocking_event);
+}
+
+TEST(evdsptc_test_group, completionfd_test){
+    evdsptc_context_t ctx;
+    evdsptc_event_t* events = (evdsptc_event_t*)malloc(sizeof(evdsptc_event_t) * 1000);
+    evdsptc_event_t* reaped[64];
+    int fd;
+    int n = 0;
+    int i;
+    int wakeups = 0;
+
+    evdsptc_create_threadpool(&ctx, NULL, NULL, NULL, 4);
+    fd = evdsptc_getcompletionfd(&ctx);
+    CHECK(0 <= fd);
+    CHECK_EQUAL(fd, evdsptc_getcompletionfd(&ctx));
+    CHECK_FALSE(fd_isreadable(fd, 0));
+
+    for(i = 0; i < 1000; i++){
+        evdsptc_event_init(&events[i], handle_inc_event, NULL, false, NULL);
+        evdsptc_post(&ctx, &events[i]);
+    }
+    while(n < 1000 && fd_isreadable(fd, 1000)){
+        wakeups++;
+        while(0 < (i = evdsptc_reapcompletions(&ctx, reaped, 64))){
+            n += i;
+            while(0 < i--) CHECK(reaped[i]->is_done);
+        }
+    }
+    CHECK_EQUAL(1000, n);
+    CHECK(wakeups <= 1000);
+    CHECK_FALSE(fd_isreadable(fd, 0));
+    evdsptc_destroy(&ctx, true);
+    free(events);
+}
+
+TEST(evdsptc_test_group, completionfd_cancel_test){
+    evdsptc_context_t ctx;
+    evdsptc_event_t* blocking_event;
+    evdsptc_event_t events[4];
+    evdsptc_event_t* reaped[8];
+    struct timespec timer = {10, 0};
+    sem_t* sem;
+    int fd;
+    int handled;
+    int n = 0;
+    int i;
+
+    evdsptc_create(&ctx, NULL, NULL, NULL);
+    fd = evdsptc_getcompletionfd(&ctx);
+    init_sem_event(&blocking_event, handle_sem_event, &sem, false);
+    mock().expectOneCall("handle_sem_event").onObject(blocking_event);
+    handled = sem_event_handled_count;
+    post(&ctx, blocking_event, false);
+    i = 0;
+    while(sem_event_handled_count == handled && i++ < USLEEP_TIMES) usleep(NUM_OF_USLEEP);
+    for(i = 0; i < 4; i++) evdsptc_event_init(&events[i], handle_inc_event, NULL, false, NULL);
+
+    // replaced, canceled and dropped events are handed back like the finished ones.
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_post_coalesce(&ctx, &events[0], 1));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_post_coalesce(&ctx, &events[1], 1));
+    evdsptc_event_settimer(&events[2], &timer, EVDSPTC_TIMERTYPE_RELATIVE);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_post(&ctx, &events[2]));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_post(&ctx, &events[3]));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_cancel(&ctx));
+    sem_post(sem);
+
+    while(n < 5 && fd_isreadable(fd, 1000)) n += evdsptc_reapcompletions(&ctx, &reaped[n], 8 - n);
+    CHECK_EQUAL(5, n);
+    for(i = 0; i < 4; i++) CHECK_EQUAL(EVDSPTC_ERROR_CANCELED, evdsptc_event_waitdone(&events[i]));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(blocking_event));
+    CHECK_EQUAL(0, ctx.timer_num);
+
+    evdsptc_destroy(&ctx, true);
+    free(sem);
+    free(blocking_event);
+}
+
+TEST(evdsptc_test_group, dispatch_test){
+    evdsptc_context_t ctx;
+    evdsptc_event_t events[3];
+    evdsptc_event_t timer_event;
+    struct timespec timer = {0, 20 * 1000 * 1000};
+    struct timespec timeout;
+    int fd;
+    int i;
+
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_create_threadpool(&ctx, NULL, NULL, NULL, 0));
+    // an event dispatcher without threads is driven by the caller.
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_create_manual(&ctx, NULL, NULL, NULL));
+    fd = evdsptc_getreadyfd(&ctx);
+    CHECK(0 <= fd);
+    CHECK_FALSE(fd_isreadable(fd, 0));
+    CHECK_EQUAL(0, evdsptc_dispatch(&ctx, &timeout));
+    CHECK_EQUAL(-1, (int)timeout.tv_sec);
+
+    for(i = 0; i < 3; i++){
+        evdsptc_event_init(&events[i], handle_inc_event, NULL, false, NULL);
+        CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_post(&ctx, &events[i]));
+    }
+    CHECK(fd_isreadable(fd, 0));
+    CHECK_EQUAL(0, inc_event_count);
+    for(i = 0; i < 3; i++){
+        CHECK(fd_isreadable(fd, 0));
+        CHECK_EQUAL(1, evdsptc_dispatch(&ctx, NULL));
+    }
+    CHECK_FALSE(fd_isreadable(fd, 0));
+    CHECK_EQUAL(3, inc_event_count);
+
+    evdsptc_event_init(&timer_event, handle_inc_event, NULL, false, NULL);
+    evdsptc_event_settimer(&timer_event, &timer, EVDSPTC_TIMERTYPE_RELATIVE);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_post(&ctx, &timer_event));
+    CHECK(fd_isreadable(fd, 0));
+    CHECK_EQUAL(0, evdsptc_dispatch(&ctx, &timeout));
+    CHECK_EQUAL(0, (int)timeout.tv_sec);
+    CHECK(0 < timeout.tv_nsec && timeout.tv_nsec <= 20 * 1000 * 1000);
+    CHECK_FALSE(fd_isreadable(fd, (int)(timeout.tv_nsec / (1000 * 1000)) + 1));
+    CHECK_EQUAL(1, evdsptc_dispatch(&ctx, &timeout));
+    CHECK_EQUAL(4, inc_event_count);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_trywaitdone(&timer_event));
+
+    // expired timer events beyond the batch size keep the fd readable with the timerfd backend.
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_settimerbackend(&ctx, EVDSPTC_TIMERBACKEND_TIMERFD, NULL));
+    for(i = 0; i < 2; i++){
+        evdsptc_event_init(&events[i], handle_inc_event, NULL, false, NULL);
+        evdsptc_event_settimer(&events[i], &timer, EVDSPTC_TIMERTYPE_RELATIVE);
+        CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_post(&ctx, &events[i]));
+    }
+    CHECK_EQUAL(0, evdsptc_dispatch(&ctx, &timeout));
+    CHECK_EQUAL(-1, (int)timeout.tv_sec);
+    CHECK(fd_isreadable(fd, 1000));
+    CHECK_EQUAL(1, evdsptc_dispatch(&ctx, &timeout));
+    CHECK_EQUAL(0, (int)timeout.tv_sec);
+    CHECK_EQUAL(0, (int)timeout.tv_nsec);
+    CHECK(fd_isreadable(fd, 0));
+    CHECK_EQUAL(1, evdsptc_dispatch(&ctx, &timeout));
+    CHECK_EQUAL(-1, (int)timeout.tv_sec);
+    CHECK_FALSE(fd_isreadable(fd, 0));
+    CHECK_EQUAL(6, inc_event_count);
+
+    evdsptc_destroy(&ctx, true);
+}
+
+static volatile int io_handled = 0;
+static pthread_t io_thread;
+static pthread_t reactor_event_thread;
+
+static void handle_io(evdsptc_io_t* io, uint32_t events){
+    char buf[16];
+    CHECK(events & POLLIN);
+    while(0 < read(io->fd, buf, sizeof(buf))) continue;
+    io_thread = pthread_self();
+    io_handled++;
+    if(io->param != NULL) evdsptc_io_unregister(io);
+}
+
+static bool handle_reactor_event(evdsptc_event_t *event){
+    (void)event;
+    reactor_event_thread = pthread_self();
+    inc_event_count++;
+    return true;
+}
+
+TEST(evdsptc_test_group, reactor_test){
+    evdsptc_context_t ctx;
+    evdsptc_io_t io;
+    evdsptc_event_t events[2];
+    struct timespec timer = {0, 20 * 1000 * 1000};
+    evdsptc_event_t* blocking_event;
+    sem_t* sem;
+    pthread_t th;
+    int fds[2];
+    int handled;
+    int i;
+
+    CHECK_EQUAL(0, pipe2(fds, O_NONBLOCK));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_create_reactor(&ctx, NULL, NULL, NULL));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_io_register(&ctx, &io, fds[0], POLLIN, handle_io, NULL));
+    io_handled = 0;
+
+    // I/O events, posted events and timer events are handled by the same thread.
+    CHECK_EQUAL(1, (int)write(fds[1], "a", 1));
+    i = 0;
+    while(io_handled < 1 && i++ < USLEEP_TIMES) usleep(NUM_OF_USLEEP);
+    CHECK_EQUAL(1, io_handled);
+    evdsptc_event_init(&events[0], handle_reactor_event, NULL, false, NULL);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, post(&ctx, &events[0], true));
+    CHECK(pthread_equal(io_thread, reactor_event_thread));
+    evdsptc_event_init(&events[1], handle_reactor_event, NULL, false, NULL);
+    evdsptc_event_settimer(&events[1], &timer, EVDSPTC_TIMERTYPE_RELATIVE);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, post(&ctx, &events[1], true));
+    CHECK_EQUAL(2, inc_event_count);
+
+    // an io is unregistered even if the queue is full.
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_setcapacity(&ctx, 1));
+    init_sem_event(&blocking_event, handle_sem_event, &sem, false);
+    mock().expectOneCall("handle_sem_event").onObject(blocking_event);
+    handled = sem_event_handled_count;
+    post(&ctx, blocking_event, false);
+    i = 0;
+    while(sem_event_handled_count == handled && i++ < USLEEP_TIMES) usleep(NUM_OF_USLEEP);
+    evdsptc_event_init(&events[1], handle_reactor_event, NULL, false, NULL);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_post(&ctx, &events[1]));
+    pthread_create(&th, NULL, release_sem_routine, sem);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_io_unregister(&io));
+    pthread_join(th, NULL);
+    CHECK_EQUAL(EVDSPTC_ERROR_INVALID, evdsptc_io_unregister(&io));
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_event_waitdone(&events[1]));
+    CHECK_EQUAL(3, inc_event_count);
+    CHECK_EQUAL(1, (int)write(fds[1], "b", 1));
+    usleep(20 * 1000);
+    CHECK_EQUAL(1, io_handled);
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_setcapacity(&ctx, 0));
+
+    // an io can be unregistered by its own handler.
+    CHECK_EQUAL(EVDSPTC_ERROR_NONE, evdsptc_io_register(&ctx, &io, fds[0], POLLIN, handle_io, (void*)&io));
+    i = 0;
+    while(io_handled < 2 && i++ < USLEEP_TIMES) usleep(NUM_OF_USLEEP);
+    CHECK_EQUAL(2, io_handled);
+    CHECK_EQUAL(1, (int)write(fds[1], "c", 1));
+    usleep(20 * 1000);
+    CHECK_EQUAL(2, io_handled);
+    CHECK(io.context == NULL);
+
+    evdsptc_destroy(&ctx, true);
+    close(fds[0]);
+    close(fds[1]);
+    free(sem);
+    free(blocking_event);
+}
+
 int main(int ac, char** av){
     return CommandLineTestRunner::RunAllTests(ac, av);
 }